@@ -0,0 +1,128 @@
+#include <benchmark.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> allocations(0);
+static std::atomic<size_t> allocatedBytes(0);
+static std::atomic<size_t> currentBytes(0);
+static std::atomic<size_t> peakBytes(0);
+
+// every block is prefixed with its size so frees can be subtracted from the live byte count
+static const size_t HEADER_SIZE = alignof(std::max_align_t);
+
+static void recordAllocation(size_t size, size_t freedSize) {
+	allocations++;
+	allocatedBytes += size;
+	size_t current = currentBytes += size;
+	currentBytes -= freedSize;
+	size_t peak = peakBytes.load();
+	while (current > peak && !peakBytes.compare_exchange_weak(peak, current)) {}
+}
+
+static void* countedAllocate(size_t size) {
+	void* block = std::malloc(size + HEADER_SIZE);
+	if (!block)
+		return nullptr;
+	*(size_t*)block = size;
+	recordAllocation(size, 0);
+
+	return (char*)block + HEADER_SIZE;
+}
+
+static void* countedReallocate(void* pointer, size_t size) {
+	if (!pointer)
+		return countedAllocate(size);
+
+	// counted like a new block that replaces the old one, the peak includes both while realloc may copy
+	void* block = (char*)pointer - HEADER_SIZE;
+	size_t oldSize = *(size_t*)block;
+	block = std::realloc(block, size + HEADER_SIZE);
+	if (!block)
+		return nullptr;
+	*(size_t*)block = size;
+	recordAllocation(size, oldSize);
+
+	return (char*)block + HEADER_SIZE;
+}
+
+static void countedFree(void* pointer) {
+	if (!pointer)
+		return;
+
+	void* block = (char*)pointer - HEADER_SIZE;
+	currentBytes -= *(size_t*)block;
+	std::free(block);
+}
+
+void* CountedMalloc(size_t size) {
+	return countedAllocate(size);
+}
+
+void* CountedRealloc(void* pointer, size_t size) {
+	return countedReallocate(pointer, size);
+}
+
+void CountedFree(void* pointer) {
+	countedFree(pointer);
+}
+
+AllocationStats GetAllocationStats() {
+	AllocationStats stats;
+	stats.allocations = allocations;
+	stats.allocatedBytes = allocatedBytes;
+	stats.currentBytes = currentBytes;
+	stats.peakBytes = peakBytes;
+	return stats;
+}
+
+void ResetAllocationPeak() {
+	peakBytes = currentBytes.load();
+}
+
+void* operator new(size_t size) {
+	void* pointer = countedAllocate(size ? size : 1);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new[](size_t size) {
+	void* pointer = countedAllocate(size ? size : 1);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	return countedAllocate(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return countedAllocate(size ? size : 1);
+}
+
+void operator delete(void* pointer) noexcept {
+	countedFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+	countedFree(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	countedFree(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+	countedFree(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+	countedFree(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+	countedFree(pointer);
+}
@@ -0,0 +1,81 @@
+#ifndef OPENGL_RENDERER_BENCHMARK_HPP
+#define OPENGL_RENDERER_BENCHMARK_HPP
+
+#include <cstddef>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Counters kept by the operator new/delete replacements in allocation.cpp
+struct AllocationStats {
+	size_t allocations;
+	size_t allocatedBytes;
+	size_t currentBytes;
+	size_t peakBytes;
+};
+
+AllocationStats GetAllocationStats();
+// restarts peak tracking from the bytes that are currently live
+void ResetAllocationPeak();
+
+// malloc style access to the same counters, the benchmark build of stb_image allocates through these
+void* CountedMalloc(size_t size);
+void* CountedRealloc(void* pointer, size_t size);
+void CountedFree(void* pointer);
+
+// Writes one flat JSON object per line so results from two builds can be diffed
+class JsonLine
+{
+public:
+	// enough digits that every double reads back to the same value
+	JsonLine() {
+		stream << std::setprecision(std::numeric_limits<double>::max_digits10);
+	}
+
+	JsonLine& Add(const std::string& key, const std::string& value) {
+		separate();
+		stream << '"' << key << "\":\"" << value << '"';
+		return *this;
+	}
+
+	JsonLine& Add(const std::string& key, double value) {
+		separate();
+		stream << '"' << key << "\":" << value;
+		return *this;
+	}
+
+	// counts are written as integers so byte and allocation totals are never rounded
+	template <typename T>
+	typename std::enable_if<std::is_integral<T>::value, JsonLine&>::type Add(const std::string& key, T value) {
+		separate();
+		stream << '"' << key << "\":" << value;
+		return *this;
+	}
+
+	std::string Str() const {
+		return stream.str() + "}";
+	}
+
+private:
+	std::ostringstream stream;
+	bool first = true;
+
+	void separate() {
+		stream << (first ? "{" : ",");
+		first = false;
+	}
+};
+
+double Minimum(const std::vector<double>& values);
+double Median(std::vector<double> values);
+// lower median, so the result is always one of the measured counts
+size_t Median(std::vector<size_t> values);
+
+int RunImportBenchmark(int argc, char** argv);
+int RunPoseBenchmark(int argc, char** argv);
+int RunMeshletBenchmark(int argc, char** argv);
+
+#endif
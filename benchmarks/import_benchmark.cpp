@@ -0,0 +1,156 @@
+#include <benchmark.hpp>
+#include <synthetic_assets.hpp>
+
+#include <model.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+// Headless upload that only records what would have been sent to the GPU
+class CountingUploader : public Uploader
+{
+public:
+	size_t textureBytes = 0;
+	size_t meshBytes = 0;
+
+	unsigned int UploadTexture(const TextureImage& image) override {
+		textureBytes += (size_t)image.width * image.height * image.components;
+		return ++textureCount;
+	}
+
+	void UploadMesh(Mesh& mesh) override {
+		meshBytes += mesh.GetByteSize();
+	}
+
+private:
+	unsigned int textureCount = 0;
+};
+
+static void printImportUsage() {
+	std::cout << "usage: benchmarks import [options]\n"
+		<< "  --vertices <n>      vertices per mesh, rounded up to a square grid (default 10000)\n"
+		<< "  --meshes <n>        mesh count (default 16)\n"
+		<< "  --texture-size <n>  texture width and height (default 512)\n"
+		<< "  --sharing <r>       fraction of meshes sharing another mesh's textures (default 0.5)\n"
+		<< "  --iterations <n>    imports to time (default 5)\n"
+		<< "  --assets <dir>      where the synthetic assets are written (default benchmark_assets)\n"
+		<< "  --output <file>     results file, one JSON object per line (default stdout)" << std::endl;
+}
+
+int RunImportBenchmark(int argc, char** argv) {
+	SyntheticModelSettings settings;
+	unsigned int iterations = 5;
+	std::string assets = "benchmark_assets";
+	std::string outputPath;
+
+	for (int i = 0; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--vertices" && hasValue)
+			settings.verticesPerMesh = std::stoul(argv[++i]);
+		else if (arg == "--meshes" && hasValue)
+			settings.meshCount = std::stoul(argv[++i]);
+		else if (arg == "--texture-size" && hasValue)
+			settings.textureSize = std::stoul(argv[++i]);
+		else if (arg == "--sharing" && hasValue)
+			settings.sharingRatio = std::stof(argv[++i]);
+		else if (arg == "--iterations" && hasValue)
+			iterations = std::max(1ul, std::stoul(argv[++i]));
+		else if (arg == "--assets" && hasValue)
+			assets = argv[++i];
+		else if (arg == "--output" && hasValue)
+			outputPath = argv[++i];
+		else {
+			printImportUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	// report the workload that is actually written, the import welds it back to exactly these vertices
+	unsigned int side = SyntheticGridSide(settings);
+	settings.verticesPerMesh = side * side;
+	settings.meshCount = std::max(1u, settings.meshCount);
+
+	stbi_set_flip_vertically_on_load(true);
+	std::string path = GenerateSyntheticModel(assets, settings);
+
+	std::vector<double> readFile, processMesh, buildMeshlets, loadMaterialTextures, textureDecode, upload, total;
+	std::vector<size_t> allocations, allocatedBytes, peakBytes;
+	ImportStats counts;
+	size_t uploadedBytes = 0;
+
+	for (unsigned int i = 0; i < iterations; i++) {
+		ResetAllocationPeak();
+		AllocationStats before = GetAllocationStats();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		{
+			Model model(path, false);
+			CountingUploader uploader;
+			model.Upload(uploader);
+
+			total.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			AllocationStats after = GetAllocationStats();
+			allocations.push_back(after.allocations - before.allocations);
+			allocatedBytes.push_back(after.allocatedBytes - before.allocatedBytes);
+			peakBytes.push_back(after.peakBytes - before.currentBytes);
+
+			counts = model.GetImportStats();
+			readFile.push_back(counts.readFile);
+			processMesh.push_back(counts.processMesh);
+			buildMeshlets.push_back(counts.buildMeshlets);
+			loadMaterialTextures.push_back(counts.loadMaterialTextures);
+			textureDecode.push_back(counts.textureDecode);
+			upload.push_back(counts.upload);
+			uploadedBytes = uploader.textureBytes + uploader.meshBytes;
+		}
+	}
+
+	if (counts.meshes != settings.meshCount || counts.vertices != (size_t)settings.verticesPerMesh * settings.meshCount) {
+		std::cout << "ERROR::IMPORT_BENCHMARK::UNEXPECTED_VERTEX_COUNT::" << counts.vertices << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ofstream file;
+	if (!outputPath.empty())
+		file.open(outputPath);
+	std::ostream& output = outputPath.empty() ? std::cout : file;
+
+	const char* stageNames[] = { "readFile", "processMesh", "buildMeshlets", "loadMaterialTextures", "textureDecode", "upload", "total" };
+	const std::vector<double>* stageTimes[] = { &readFile, &processMesh, &buildMeshlets, &loadMaterialTextures, &textureDecode, &upload, &total };
+	for (unsigned int i = 0; i < 7; i++) {
+		JsonLine line;
+		line.Add("benchmark", "import")
+			.Add("vertices", settings.verticesPerMesh)
+			.Add("meshes", settings.meshCount)
+			.Add("texture_size", settings.textureSize)
+			.Add("sharing", settings.sharingRatio)
+			.Add("stage", stageNames[i])
+			.Add("median_ms", Median(*stageTimes[i]) * 1000.0)
+			.Add("min_ms", Minimum(*stageTimes[i]) * 1000.0);
+		output << line.Str() << "\n";
+	}
+
+	JsonLine summary;
+	summary.Add("benchmark", "import")
+		.Add("vertices", settings.verticesPerMesh)
+		.Add("meshes", settings.meshCount)
+		.Add("texture_size", settings.textureSize)
+		.Add("sharing", settings.sharingRatio)
+		.Add("stage", "memory")
+		.Add("allocations", Median(allocations))
+		.Add("allocated_bytes", Median(allocatedBytes))
+		.Add("peak_bytes", Median(peakBytes))
+		.Add("uploaded_bytes", uploadedBytes)
+		.Add("imported_meshes", counts.meshes)
+		.Add("imported_vertices", counts.vertices)
+		.Add("imported_indices", counts.indices)
+		.Add("textures_decoded", counts.texturesDecoded)
+		.Add("textures_shared", counts.texturesShared);
+	output << summary.Str() << std::endl;
+
+	return EXIT_SUCCESS;
+}
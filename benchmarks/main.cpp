@@ -0,0 +1,42 @@
+#include <benchmark.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+double Minimum(const std::vector<double>& values) {
+	return *std::min_element(values.begin(), values.end());
+}
+
+double Median(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	size_t middle = values.size() / 2;
+	if (values.size() % 2 == 0)
+		return (values[middle - 1] + values[middle]) * 0.5;
+	return values[middle];
+}
+
+size_t Median(std::vector<size_t> values) {
+	std::sort(values.begin(), values.end());
+	return values[(values.size() - 1) / 2];
+}
+
+// Headless benchmarks, no window or GL context is created
+int main(int argc, char** argv) {
+	std::string benchmark = argc > 1 ? argv[1] : "";
+
+	if (benchmark == "import")
+		return RunImportBenchmark(argc - 2, argv + 2);
+	if (benchmark == "pose")
+		return RunPoseBenchmark(argc - 2, argv + 2);
+	if (benchmark == "meshlet")
+		return RunMeshletBenchmark(argc - 2, argv + 2);
+
+	std::cout << "usage: benchmarks <benchmark> [options]\n"
+		<< "benchmarks:\n"
+		<< "  import    time each stage of loading a synthetic model\n"
+		<< "  pose      time skeletal pose evaluation for many animated instances\n"
+		<< "  meshlet   check meshlet building and culling on synthetic meshes and time both" << std::endl;
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,481 @@
+#include <benchmark.hpp>
+#include <synthetic_assets.hpp>
+
+#include <mesh.hpp>
+#include <meshlet.hpp>
+#include <model.hpp>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+struct MeshletBenchmarkSettings {
+	unsigned int gridSize = 256;
+	unsigned int sphereSegments = 128;
+	unsigned int cameras = 64;
+	unsigned int iterations = 20;
+};
+
+struct SyntheticMesh {
+	std::string name;
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+};
+
+static Vertex makeVertex(const glm::vec3& position, const glm::vec3& normal) {
+	Vertex vertex;
+	vertex.position = position;
+	vertex.normal = normal;
+	vertex.texCoords = glm::vec2(0.0f);
+	return vertex;
+}
+
+// Square grid over [-1, 1] facing +z, waveHeight > 0 bends it so meshlets get cones of different widths
+static SyntheticMesh createGrid(const std::string& name, unsigned int side, float waveHeight) {
+	SyntheticMesh mesh;
+	mesh.name = name;
+	for (unsigned int y = 0; y < side; y++) {
+		for (unsigned int x = 0; x < side; x++) {
+			float u = (float)x / (side - 1) * 2.0f - 1.0f;
+			float v = (float)y / (side - 1) * 2.0f - 1.0f;
+			float z = waveHeight * std::sin(u * 6.0f) * std::cos(v * 4.0f);
+			mesh.vertices.push_back(makeVertex(glm::vec3(u, v, z), glm::vec3(0.0f, 0.0f, 1.0f)));
+		}
+	}
+
+	for (unsigned int y = 0; y + 1 < side; y++) {
+		for (unsigned int x = 0; x + 1 < side; x++) {
+			unsigned int a = y * side + x;
+			unsigned int b = a + 1;
+			unsigned int c = a + side;
+			unsigned int d = c + 1;
+			mesh.indices.insert(mesh.indices.end(), { a, b, d, a, d, c });
+		}
+	}
+	return mesh;
+}
+
+// Closed unit sphere with counter clockwise outward faces, the poles are single shared vertices
+static SyntheticMesh createSphere(const std::string& name, unsigned int segments) {
+	SyntheticMesh mesh;
+	mesh.name = name;
+	unsigned int rings = std::max(2u, segments / 2);
+
+	mesh.vertices.push_back(makeVertex(glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+	for (unsigned int ring = 1; ring < rings; ring++) {
+		float theta = 3.14159265f * ring / rings;
+		for (unsigned int segment = 0; segment < segments; segment++) {
+			float phi = 2.0f * 3.14159265f * segment / segments;
+			glm::vec3 position = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), -std::sin(theta) * std::sin(phi));
+			mesh.vertices.push_back(makeVertex(position, position));
+		}
+	}
+	mesh.vertices.push_back(makeVertex(glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
+	unsigned int bottom = (unsigned int)mesh.vertices.size() - 1;
+
+	for (unsigned int segment = 0; segment < segments; segment++) {
+		unsigned int next = (segment + 1) % segments;
+		mesh.indices.insert(mesh.indices.end(), { 0, 1 + segment, 1 + next });
+	}
+	for (unsigned int ring = 0; ring + 2 < rings; ring++) {
+		for (unsigned int segment = 0; segment < segments; segment++) {
+			unsigned int next = (segment + 1) % segments;
+			unsigned int a = 1 + ring * segments + segment;
+			unsigned int b = 1 + ring * segments + next;
+			unsigned int c = a + segments;
+			unsigned int d = b + segments;
+			mesh.indices.insert(mesh.indices.end(), { a, c, d, a, d, b });
+		}
+	}
+	unsigned int lastRing = 1 + (rings - 2) * segments;
+	for (unsigned int segment = 0; segment < segments; segment++) {
+		unsigned int next = (segment + 1) % segments;
+		mesh.indices.insert(mesh.indices.end(), { lastRing + segment, bottom, lastRing + next });
+	}
+	return mesh;
+}
+
+// Every triangle gets its own three vertices, which is what an OBJ import gives without welding
+static SyntheticMesh unweld(const SyntheticMesh& mesh, const std::string& name) {
+	SyntheticMesh result;
+	result.name = name;
+	for (unsigned int i = 0; i < mesh.indices.size(); i++) {
+		result.vertices.push_back(mesh.vertices[mesh.indices[i]]);
+		result.indices.push_back(i);
+	}
+	return result;
+}
+
+static bool fail(const std::string& check, const std::string& detail) {
+	std::cout << "ERROR::MESHLET_BENCHMARK::" << check << "::" << detail << std::endl;
+	return false;
+}
+
+static std::vector<std::array<unsigned int, 3>> sortedTriangles(const std::vector<unsigned int>& indices) {
+	std::vector<std::array<unsigned int, 3>> triangles;
+	for (unsigned int i = 0; i + 2 < indices.size(); i += 3) {
+		triangles.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// Limits, contiguous ranges, every source triangle emitted exactly once with its winding, and bounds that hold
+static bool checkMeshlets(const SyntheticMesh& mesh, const std::vector<unsigned int>& indices, const std::vector<Meshlet>& meshlets) {
+	if (sortedTriangles(mesh.indices) != sortedTriangles(indices))
+		return fail("TRIANGLES_CHANGED", mesh.name);
+
+	unsigned int expectedOffset = 0;
+	std::vector<unsigned int> vertexMeshlet(mesh.vertices.size(), (unsigned int)-1);
+	for (unsigned int i = 0; i < meshlets.size(); i++) {
+		const Meshlet& meshlet = meshlets[i];
+		std::string detail = mesh.name + "::" + std::to_string(i);
+
+		if (meshlet.indexOffset != expectedOffset || meshlet.indexCount == 0 || meshlet.indexCount % 3 != 0)
+			return fail("RANGE_NOT_CONTIGUOUS", detail);
+		expectedOffset += meshlet.indexCount;
+		if (meshlet.indexCount / 3 > MESHLET_MAX_TRIANGLES)
+			return fail("TOO_MANY_TRIANGLES", detail);
+
+		unsigned int vertexCount = 0;
+		for (unsigned int j = meshlet.indexOffset; j < meshlet.indexOffset + meshlet.indexCount; j++) {
+			if (vertexMeshlet[indices[j]] != i) {
+				vertexMeshlet[indices[j]] = i;
+				vertexCount++;
+			}
+		}
+		if (vertexCount > MESHLET_MAX_VERTICES || vertexCount != meshlet.vertexCount)
+			return fail("VERTEX_COUNT", detail);
+
+		for (unsigned int j = meshlet.indexOffset; j < meshlet.indexOffset + meshlet.indexCount; j += 3) {
+			glm::vec3 a = mesh.vertices[indices[j]].position;
+			glm::vec3 b = mesh.vertices[indices[j + 1]].position;
+			glm::vec3 c = mesh.vertices[indices[j + 2]].position;
+			for (unsigned int k = 0; k < 3; k++) {
+				if (glm::length(mesh.vertices[indices[j + k]].position - meshlet.center) > meshlet.radius * 1.0001f + 1e-6f)
+					return fail("VERTEX_OUTSIDE_SPHERE", detail);
+			}
+
+			// every face normal lies inside the cone, sin of its angle to the axis is at most the cutoff
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			if (meshlet.coneCutoff < 1.0f && glm::length(normal) > 0.0f) {
+				float cosine = glm::dot(glm::normalize(normal), meshlet.coneAxis);
+				if (cosine <= 0.0f || std::sqrt(std::fmax(0.0f, 1.0f - cosine * cosine)) > meshlet.coneCutoff + 1e-4f)
+					return fail("NORMAL_OUTSIDE_CONE", detail);
+			}
+		}
+	}
+	if (expectedOffset != indices.size())
+		return fail("RANGE_NOT_CONTIGUOUS", mesh.name + "::end");
+
+	return true;
+}
+
+static bool checkFrustumExtraction() {
+	// the identity matrix is the clip space cube, every plane sits one unit from the origin
+	Frustum frustum = ExtractFrustum(glm::mat4(1.0f));
+	const glm::vec4 expected[6] = {
+		glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), glm::vec4(-1.0f, 0.0f, 0.0f, 1.0f),
+		glm::vec4(0.0f, 1.0f, 0.0f, 1.0f), glm::vec4(0.0f, -1.0f, 0.0f, 1.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), glm::vec4(0.0f, 0.0f, -1.0f, 1.0f)
+	};
+	for (unsigned int i = 0; i < 6; i++) {
+		glm::vec4 difference = frustum.planes[i] - expected[i];
+		if (glm::dot(difference, difference) > 1e-10f)
+			return fail("FRUSTUM_PLANE", std::to_string(i));
+	}
+
+	// planes of a perspective frustum are unit length and keep points in front of the camera inside
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 100.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	frustum = ExtractFrustum(projection * view);
+	for (unsigned int i = 0; i < 6; i++) {
+		if (std::fabs(glm::length(glm::vec3(frustum.planes[i])) - 1.0f) > 1e-4f)
+			return fail("FRUSTUM_NOT_NORMALIZED", std::to_string(i));
+		if (glm::dot(glm::vec3(frustum.planes[i]), glm::vec3(0.0f)) + frustum.planes[i].w <= 0.0f)
+			return fail("FRUSTUM_ORIGIN_OUTSIDE", std::to_string(i));
+	}
+	if (glm::dot(glm::vec3(frustum.planes[4]), glm::vec3(0.0f, 0.0f, 4.95f)) + frustum.planes[4].w >= 0.0f)
+		return fail("FRUSTUM_NEAR_PLANE", "behind near plane inside");
+
+	return true;
+}
+
+static bool checkVisibilityCases() {
+	Frustum frustum = ExtractFrustum(glm::mat4(1.0f));
+
+	Meshlet meshlet = {};
+	meshlet.radius = 0.5f;
+	meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = 1.0f;
+	glm::vec3 camera = glm::vec3(0.0f, 0.0f, 10.0f);
+
+	// sphere rejection, a sphere touching a plane from outside is still visible
+	meshlet.center = glm::vec3(0.0f);
+	if (!IsMeshletVisible(meshlet, frustum, camera))
+		return fail("SPHERE", "inside culled");
+	meshlet.center = glm::vec3(1.4f, 0.0f, 0.0f);
+	if (!IsMeshletVisible(meshlet, frustum, camera))
+		return fail("SPHERE", "straddling culled");
+	meshlet.center = glm::vec3(1.6f, 0.0f, 0.0f);
+	if (IsMeshletVisible(meshlet, frustum, camera))
+		return fail("SPHERE", "outside right visible");
+	meshlet.center = glm::vec3(0.0f, 0.0f, -1.6f);
+	if (IsMeshletVisible(meshlet, frustum, camera))
+		return fail("SPHERE", "outside near visible");
+
+	// cone rejection, a cluster facing +z within 30 degrees
+	meshlet.center = glm::vec3(0.0f);
+	meshlet.radius = 0.1f;
+	meshlet.coneCutoff = 0.5f;
+	if (!IsMeshletVisible(meshlet, frustum, glm::vec3(0.0f, 0.0f, 10.0f)))
+		return fail("CONE", "front culled");
+	if (!IsMeshletVisible(meshlet, frustum, glm::vec3(10.0f, 0.0f, 0.0f)))
+		return fail("CONE", "side culled");
+	if (IsMeshletVisible(meshlet, frustum, glm::vec3(0.0f, 0.0f, -10.0f)))
+		return fail("CONE", "behind visible");
+	// just outside the cone's shadow, some face could still be seen
+	if (!IsMeshletVisible(meshlet, frustum, glm::vec3(std::sin(glm::radians(65.0f)), 0.0f, -std::cos(glm::radians(65.0f))) * 10.0f))
+		return fail("CONE", "edge culled");
+
+	// a cutoff of 1 never culls
+	meshlet.coneCutoff = 1.0f;
+	if (!IsMeshletVisible(meshlet, frustum, glm::vec3(0.0f, 0.0f, -10.0f)))
+		return fail("CONE", "disabled culled");
+
+	return true;
+}
+
+static bool isBackfacing(const SyntheticMesh& mesh, const std::vector<unsigned int>& indices, unsigned int index, const glm::vec3& camera) {
+	glm::vec3 a = mesh.vertices[indices[index]].position;
+	glm::vec3 b = mesh.vertices[indices[index + 1]].position;
+	glm::vec3 c = mesh.vertices[indices[index + 2]].position;
+	glm::vec3 normal = glm::cross(b - a, c - a);
+	return glm::dot(normal, camera - a) <= 1e-6f * glm::length(normal);
+}
+
+static bool isOutsidePlane(const SyntheticMesh& mesh, const std::vector<unsigned int>& indices, const Meshlet& meshlet, const glm::vec4& plane) {
+	for (unsigned int i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i++) {
+		if (glm::dot(glm::vec3(plane), mesh.vertices[indices[i]].position) + plane.w >= 0.0f)
+			return false;
+	}
+	return true;
+}
+
+// Culling must be conservative: a culled meshlet is wholly outside one plane or has no front facing triangle.
+// CullMeshlets must draw exactly the visible meshlets as ascending, non overlapping ranges
+static bool checkCulling(const SyntheticMesh& mesh, const std::vector<unsigned int>& indices, const std::vector<Meshlet>& meshlets,
+	const std::vector<glm::mat4>& viewProjections, const std::vector<glm::vec3>& positions, double& visibleFraction) {
+	std::vector<int> counts;
+	std::vector<const void*> offsets;
+	size_t visibleIndices = 0;
+
+	for (unsigned int i = 0; i < positions.size(); i++) {
+		Frustum frustum = ExtractFrustum(viewProjections[i]);
+		std::string detail = mesh.name + "::camera_" + std::to_string(i);
+
+		size_t expectedIndices = 0;
+		for (unsigned int j = 0; j < meshlets.size(); j++) {
+			const Meshlet& meshlet = meshlets[j];
+			if (IsMeshletVisible(meshlet, frustum, positions[i])) {
+				expectedIndices += meshlet.indexCount;
+				continue;
+			}
+
+			bool outside = false;
+			for (unsigned int k = 0; k < 6 && !outside; k++) {
+				outside = isOutsidePlane(mesh, indices, meshlet, frustum.planes[k]);
+			}
+
+			bool backfacing = true;
+			for (unsigned int k = meshlet.indexOffset; k < meshlet.indexOffset + meshlet.indexCount && backfacing; k += 3) {
+				backfacing = isBackfacing(mesh, indices, k, positions[i]);
+			}
+
+			if (!outside && !backfacing)
+				return fail("CULLED_VISIBLE_MESHLET", detail + "::" + std::to_string(j));
+		}
+
+		CullMeshlets(meshlets, frustum, positions[i], counts, offsets);
+		if (counts.size() != offsets.size())
+			return fail("DRAW_RANGES", detail);
+
+		size_t drawnIndices = 0;
+		size_t rangeEnd = 0;
+		for (unsigned int j = 0; j < counts.size(); j++) {
+			size_t first = (size_t)offsets[j] / sizeof(unsigned int);
+			if (counts[j] <= 0 || (j > 0 && first <= rangeEnd) || first + counts[j] > indices.size())
+				return fail("DRAW_RANGES", detail);
+			rangeEnd = first + counts[j];
+			drawnIndices += counts[j];
+		}
+		if (drawnIndices != expectedIndices)
+			return fail("DRAW_RANGES", detail + "::count");
+
+		visibleIndices += drawnIndices;
+	}
+
+	visibleFraction = (double)visibleIndices / ((double)indices.size() * (double)positions.size());
+	return true;
+}
+
+// The renderer's import must weld the per corner vertices of an OBJ. Unwelded, no two triangles share a vertex and
+// each meshlet is cut at MESHLET_MAX_VERTICES / 3 triangles in file order
+static bool checkImportedMeshlets(const std::string& assets, unsigned int gridSize, double& trianglesPerMeshlet) {
+	SyntheticModelSettings settings;
+	settings.verticesPerMesh = gridSize * gridSize;
+	settings.meshCount = 4;
+	settings.textureSize = 4;
+
+	Model model(GenerateSyntheticModel(assets, settings), false);
+	const ImportStats& stats = model.GetImportStats();
+	if (stats.meshlets == 0)
+		return fail("IMPORT_FAILED", assets);
+	if (stats.vertices != (size_t)settings.verticesPerMesh * settings.meshCount)
+		return fail("IMPORT_NOT_WELDED", std::to_string(stats.vertices) + " vertices");
+
+	trianglesPerMeshlet = (double)stats.indices / 3.0 / (double)stats.meshlets;
+	if (trianglesPerMeshlet <= 2.0 * MESHLET_MAX_VERTICES / 3.0)
+		return fail("IMPORT_MESHLETS_TOO_SMALL", std::to_string(trianglesPerMeshlet) + " triangles per meshlet");
+
+	return true;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void printMeshletUsage() {
+	std::cout << "usage: benchmarks meshlet [options]\n"
+		<< "  --grid <n>        vertices per side of the grid meshes (default 256)\n"
+		<< "  --segments <n>    segments around the sphere mesh (default 128)\n"
+		<< "  --cameras <n>     random cameras culled against per iteration (default 64)\n"
+		<< "  --iterations <n>  times each stage is repeated (default 20)\n"
+		<< "  --assets <dir>    where the synthetic model for the import check is written (default benchmark_assets/meshlet)\n"
+		<< "  --output <file>   results file, one JSON object per line (default stdout)" << std::endl;
+}
+
+int RunMeshletBenchmark(int argc, char** argv) {
+	MeshletBenchmarkSettings settings;
+	std::string assets = "benchmark_assets/meshlet";
+	std::string outputPath;
+
+	for (int i = 0; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--grid" && hasValue)
+			settings.gridSize = std::max(2ul, std::stoul(argv[++i]));
+		else if (arg == "--segments" && hasValue)
+			settings.sphereSegments = std::max(3ul, std::stoul(argv[++i]));
+		else if (arg == "--cameras" && hasValue)
+			settings.cameras = std::max(1ul, std::stoul(argv[++i]));
+		else if (arg == "--iterations" && hasValue)
+			settings.iterations = std::max(1ul, std::stoul(argv[++i]));
+		else if (arg == "--assets" && hasValue)
+			assets = argv[++i];
+		else if (arg == "--output" && hasValue)
+			outputPath = argv[++i];
+		else {
+			printMeshletUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	double importedTrianglesPerMeshlet = 0.0;
+	if (!checkFrustumExtraction() || !checkVisibilityCases() || !checkImportedMeshlets(assets, settings.gridSize, importedTrianglesPerMeshlet))
+		return EXIT_FAILURE;
+
+	std::vector<SyntheticMesh> meshes;
+	meshes.push_back(createGrid("grid", settings.gridSize, 0.0f));
+	meshes.push_back(createGrid("wave", settings.gridSize, 0.15f));
+	meshes.push_back(createSphere("sphere", settings.sphereSegments));
+	meshes.push_back(unweld(meshes[1], "wave_unwelded"));
+
+	// cameras around the origin looking at points near it, fixed seed so every run culls the same views
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<glm::mat4> viewProjections;
+	std::vector<glm::vec3> positions;
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+	while (positions.size() < settings.cameras) {
+		glm::vec3 direction = glm::vec3(unit(random), unit(random), unit(random));
+		float length = glm::length(direction);
+		if (length < 0.1f || length > 1.0f || std::fabs(direction.x) + std::fabs(direction.z) < 0.1f)
+			continue;
+
+		glm::vec3 position = direction / length * (1.5f + 2.5f * (unit(random) * 0.5f + 0.5f));
+		glm::vec3 target = glm::vec3(unit(random), unit(random), unit(random)) * 0.5f;
+		positions.push_back(position);
+		viewProjections.push_back(projection * glm::lookAt(position, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+	}
+
+	std::ofstream file;
+	if (!outputPath.empty())
+		file.open(outputPath);
+	std::ostream& output = outputPath.empty() ? std::cout : file;
+
+	JsonLine imported;
+	imported.Add("benchmark", "meshlet")
+		.Add("mesh", "imported_grid")
+		.Add("stage", "import")
+		.Add("triangles_per_meshlet", importedTrianglesPerMeshlet);
+	output << imported.Str() << "\n";
+
+	for (unsigned int i = 0; i < meshes.size(); i++) {
+		const SyntheticMesh& mesh = meshes[i];
+
+		std::vector<unsigned int> indices;
+		std::vector<Meshlet> meshlets;
+		std::vector<double> build;
+		for (unsigned int j = 0; j < settings.iterations; j++) {
+			indices = mesh.indices;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			meshlets = BuildMeshlets(mesh.vertices, indices);
+			build.push_back(secondsSince(start));
+		}
+
+		double visibleFraction = 0.0;
+		if (!checkMeshlets(mesh, indices, meshlets) || !checkCulling(mesh, indices, meshlets, viewProjections, positions, visibleFraction))
+			return EXIT_FAILURE;
+
+		// cull time is per camera, frustum extraction included since the renderer does it per draw
+		std::vector<int> counts;
+		std::vector<const void*> offsets;
+		std::vector<double> cull;
+		for (unsigned int j = 0; j < settings.iterations; j++) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (unsigned int k = 0; k < positions.size(); k++) {
+				CullMeshlets(meshlets, ExtractFrustum(viewProjections[k]), positions[k], counts, offsets);
+			}
+			cull.push_back(secondsSince(start) / (double)positions.size());
+		}
+
+		const char* stageNames[] = { "build", "cull" };
+		const std::vector<double>* stageTimes[] = { &build, &cull };
+		for (unsigned int j = 0; j < 2; j++) {
+			JsonLine line;
+			line.Add("benchmark", "meshlet")
+				.Add("mesh", mesh.name)
+				.Add("stage", stageNames[j])
+				.Add("median_ms", Median(*stageTimes[j]) * 1000.0)
+				.Add("min_ms", Minimum(*stageTimes[j]) * 1000.0)
+				.Add("triangles", mesh.indices.size() / 3)
+				.Add("meshlets", meshlets.size())
+				.Add("triangles_per_meshlet", (double)mesh.indices.size() / 3.0 / (double)meshlets.size());
+			if (j == 1)
+				line.Add("cameras", settings.cameras).Add("visible_fraction", visibleFraction);
+			output << line.Str() << "\n";
+		}
+	}
+	output.flush();
+
+	return EXIT_SUCCESS;
+}
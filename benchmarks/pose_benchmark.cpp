@@ -0,0 +1,291 @@
+#include <benchmark.hpp>
+
+#include <animation.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+struct PoseBenchmarkSettings {
+	unsigned int instances = 500;
+	unsigned int joints = 64;
+	float clipLength = 2.0f;
+	unsigned int iterations = 100;
+	unsigned int threads = 0;
+};
+
+// A tree of joints where every joint is also a skinning bone
+static Skeleton createSkeleton(unsigned int jointCount) {
+	Skeleton skeleton;
+	skeleton.bindPose.Resize(jointCount);
+	for (unsigned int i = 0; i < jointCount; i++) {
+		skeleton.jointNames.push_back("joint_" + std::to_string(i));
+		skeleton.jointIndices[skeleton.jointNames.back()] = i;
+		skeleton.parents.push_back(i == 0 ? -1 : (int)(i - 1) / 3);
+		skeleton.bindPose.Component(POSE_TY)[i] = i == 0 ? 0.0f : 0.5f;
+
+		if (i < MAX_BONES) {
+			skeleton.boneJoints.push_back(i);
+			skeleton.boneOffsets.push_back(glm::mat4(1.0f));
+		}
+	}
+	return skeleton;
+}
+
+// Every joint swings around one axis, each clip at its own rate
+static AnimationClip createClip(const Skeleton& skeleton, float duration, float rate) {
+	AnimationClip clip;
+	clip.duration = duration;
+	clip.frameCount = (unsigned int)std::ceil(duration * ANIMATION_SAMPLE_RATE) + 1;
+	clip.stride = skeleton.bindPose.stride;
+
+	unsigned int frameSize = POSE_COMPONENTS * clip.stride;
+	clip.frames.resize(clip.frameCount * frameSize);
+	for (unsigned int i = 0; i < clip.frameCount; i++) {
+		Pose pose = skeleton.bindPose;
+		for (unsigned int j = 0; j < skeleton.GetJointCount(); j++) {
+			float angle = std::sin(i / ANIMATION_SAMPLE_RATE * rate + j) * 0.5f;
+			pose.Component((Pose_Component)(POSE_RX + j % 3))[j] = std::sin(angle * 0.5f);
+			pose.Component(POSE_RW)[j] = std::cos(angle * 0.5f);
+		}
+		std::copy(pose.data.begin(), pose.data.end(), clip.frames.begin() + i * frameSize);
+	}
+	return clip;
+}
+
+static bool fail(const std::string& check, const std::string& detail) {
+	std::cout << "ERROR::POSE_BENCHMARK::" << check << "::" << detail << std::endl;
+	return false;
+}
+
+static void referenceNormalizeRotations(Pose& pose) {
+	for (unsigned int i = 0; i < pose.stride; i++) {
+		float length = std::sqrt(pose.Component(POSE_RX)[i] * pose.Component(POSE_RX)[i] + pose.Component(POSE_RY)[i] * pose.Component(POSE_RY)[i]
+			+ pose.Component(POSE_RZ)[i] * pose.Component(POSE_RZ)[i] + pose.Component(POSE_RW)[i] * pose.Component(POSE_RW)[i]);
+		for (unsigned int j = POSE_RX; j <= POSE_RW; j++)
+			pose.Component((Pose_Component)j)[i] /= length;
+	}
+}
+
+// Scalar SampleClip, the SSE2 path must give the same pose
+static void referenceSampleClip(const AnimationClip& clip, float time, Pose& pose) {
+	unsigned int frameSize = POSE_COMPONENTS * clip.stride;
+	pose.stride = clip.stride;
+	pose.data.resize(frameSize);
+
+	float position = std::fmod(time, clip.duration);
+	if (position < 0.0f)
+		position += clip.duration;
+	position *= ANIMATION_SAMPLE_RATE;
+	unsigned int frame = std::min((unsigned int)position, clip.frameCount - 1);
+	unsigned int nextFrame = std::min(frame + 1, clip.frameCount - 1);
+	float t = position - frame;
+
+	for (unsigned int i = 0; i < frameSize; i++) {
+		float a = clip.frames[frame * frameSize + i];
+		float b = clip.frames[nextFrame * frameSize + i];
+		pose.data[i] = a + (b - a) * t;
+	}
+	referenceNormalizeRotations(pose);
+}
+
+// Scalar BlendPoses, rotations take the short path between the two poses
+static void referenceBlendPoses(const Pose& a, const Pose& b, float weight, Pose& out) {
+	out = a;
+	for (unsigned int i = 0; i < a.stride; i++) {
+		float dot = 0.0f;
+		for (unsigned int j = POSE_RX; j <= POSE_RW; j++)
+			dot += a.Component((Pose_Component)j)[i] * b.Component((Pose_Component)j)[i];
+
+		for (unsigned int j = 0; j < POSE_COMPONENTS; j++) {
+			float from = a.Component((Pose_Component)j)[i];
+			float to = b.Component((Pose_Component)j)[i];
+			if (j >= POSE_RX && j <= POSE_RW && dot < 0.0f)
+				to = -to;
+			out.Component((Pose_Component)j)[i] = from + (to - from) * weight;
+		}
+	}
+	referenceNormalizeRotations(out);
+}
+
+static bool posesMatch(const Pose& a, const Pose& b) {
+	if (a.stride != b.stride || a.data.size() != b.data.size())
+		return false;
+	for (unsigned int i = 0; i < a.data.size(); i++) {
+		if (std::fabs(a.data[i] - b.data[i]) > 1e-5f)
+			return false;
+	}
+	return true;
+}
+
+// SampleClip and BlendPoses against the scalar references for every instance's clip times
+static bool checkPoseEvaluation(const std::vector<AnimationClip>& clips, const std::vector<AnimationInstance>& instances) {
+	Pose pose, blendPose, expected, expectedBlend;
+	for (unsigned int i = 0; i < instances.size(); i++) {
+		const AnimationInstance& instance = instances[i];
+		SampleClip(clips[instance.clip], instance.time, pose);
+		referenceSampleClip(clips[instance.clip], instance.time, expected);
+		if (!posesMatch(pose, expected))
+			return fail("SAMPLE_MISMATCH", std::to_string(i));
+
+		unsigned int other = (instance.clip + 1) % (unsigned int)clips.size();
+		SampleClip(clips[other], instance.blendTime + 0.37f, blendPose);
+		referenceSampleClip(clips[other], instance.blendTime + 0.37f, expectedBlend);
+
+		// every other instance blends towards the same rotations from the opposite hemisphere, which must take the short path
+		if (i % 2 == 1) {
+			for (unsigned int j = POSE_RX * blendPose.stride; j < POSE_SX * blendPose.stride; j++) {
+				blendPose.data[j] = -blendPose.data[j];
+				expectedBlend.data[j] = -expectedBlend.data[j];
+			}
+		}
+		float weight = (i % 5) * 0.25f;
+		BlendPoses(pose, blendPose, weight, pose);
+		referenceBlendPoses(expected, expectedBlend, weight, expected);
+		if (!posesMatch(pose, expected))
+			return fail("BLEND_MISMATCH", std::to_string(i));
+	}
+	return true;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void printPoseUsage() {
+	std::cout << "usage: benchmarks pose [options]\n"
+		<< "  --instances <n>   animated instances (default 500)\n"
+		<< "  --joints <n>      joints per skeleton (default 64)\n"
+		<< "  --iterations <n>  frames to time (default 100)\n"
+		<< "  --threads <n>     Animator worker threads, 0 for one per core (default 0)\n"
+		<< "  --output <file>   results file, one JSON object per line (default stdout)" << std::endl;
+}
+
+int RunPoseBenchmark(int argc, char** argv) {
+	PoseBenchmarkSettings settings;
+	std::string outputPath;
+
+	for (int i = 0; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--instances" && hasValue)
+			settings.instances = std::max(1ul, std::stoul(argv[++i]));
+		else if (arg == "--joints" && hasValue)
+			settings.joints = std::max(1ul, std::stoul(argv[++i]));
+		else if (arg == "--iterations" && hasValue)
+			settings.iterations = std::max(1ul, std::stoul(argv[++i]));
+		else if (arg == "--threads" && hasValue)
+			settings.threads = std::stoul(argv[++i]);
+		else if (arg == "--output" && hasValue)
+			outputPath = argv[++i];
+		else {
+			printPoseUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	Skeleton skeleton = createSkeleton(settings.joints);
+	std::vector<AnimationClip> clips;
+	clips.push_back(createClip(skeleton, settings.clipLength, 3.0f));
+	clips.push_back(createClip(skeleton, settings.clipLength, 5.0f));
+
+	// half of the instances blend the second clip over the first
+	std::vector<AnimationInstance> instances(settings.instances);
+	for (unsigned int i = 0; i < instances.size(); i++) {
+		instances[i].clip = i % 2;
+		instances[i].time = i * 0.013f;
+		if (i % 2 == 0) {
+			instances[i].blendClip = 1;
+			instances[i].blendTime = i * 0.007f;
+			instances[i].blendWeight = 0.5f;
+		}
+	}
+
+	if (!checkPoseEvaluation(clips, instances))
+		return EXIT_FAILURE;
+
+	// single threaded cost of each evaluation step
+	Pose pose, blendPose;
+	std::vector<glm::mat4> modelSpace;
+	std::vector<glm::mat4> palette(skeleton.boneJoints.size());
+	std::vector<double> sample, blend, computePalette;
+	for (unsigned int i = 0; i < settings.iterations; i++) {
+		float time = i / 60.0f;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned int j = 0; j < instances.size(); j++)
+			SampleClip(clips[instances[j].clip], instances[j].time + time, pose);
+		sample.push_back(secondsSince(start));
+
+		SampleClip(clips[1], time, blendPose);
+		start = std::chrono::steady_clock::now();
+		for (unsigned int j = 0; j < instances.size(); j++)
+			BlendPoses(pose, blendPose, instances[j].blendWeight, pose);
+		blend.push_back(secondsSince(start));
+
+		start = std::chrono::steady_clock::now();
+		for (unsigned int j = 0; j < instances.size(); j++)
+			ComputeBonePalette(skeleton, pose, modelSpace, palette.data());
+		computePalette.push_back(secondsSince(start));
+	}
+
+	// full Animator update, single threaded and across workers
+	unsigned int threads = settings.threads ? settings.threads : std::max(1u, std::thread::hardware_concurrency());
+	std::vector<double> update, parallelUpdate;
+	Animator serial(skeleton, clips, 1);
+	Animator parallel(skeleton, clips, threads);
+	serial.instances = instances;
+	parallel.instances = instances;
+
+	// the first update sizes the palettes and wakes the workers for the first time, only the steady state is timed
+	serial.Update(0.0f);
+	parallel.Update(0.0f);
+	for (unsigned int i = 0; i < settings.iterations; i++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		serial.Update(1.0f / 60.0f);
+		update.push_back(secondsSince(start));
+
+		start = std::chrono::steady_clock::now();
+		parallel.Update(1.0f / 60.0f);
+		parallelUpdate.push_back(secondsSince(start));
+	}
+
+	// both animators ran the same updates, splitting instances across workers must not change any palette
+	size_t paletteSize = skeleton.boneJoints.size() * sizeof(glm::mat4);
+	for (unsigned int i = 0; i < instances.size(); i++) {
+		if (std::memcmp(serial.GetPalette(i), parallel.GetPalette(i), paletteSize) != 0) {
+			fail("PARALLEL_PALETTE_MISMATCH", std::to_string(i));
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::ofstream file;
+	if (!outputPath.empty())
+		file.open(outputPath);
+	std::ostream& output = outputPath.empty() ? std::cout : file;
+
+	const char* stageNames[] = { "sample", "blend", "palette", "update", "update_parallel" };
+	const std::vector<double>* stageTimes[] = { &sample, &blend, &computePalette, &update, &parallelUpdate };
+	const unsigned int stageThreads[] = { 1, 1, 1, 1, threads };
+	for (unsigned int i = 0; i < 5; i++) {
+		double median = Median(*stageTimes[i]);
+		JsonLine line;
+		line.Add("benchmark", "pose")
+			.Add("instances", settings.instances)
+			.Add("joints", settings.joints)
+			.Add("threads", stageThreads[i])
+			.Add("stage", stageNames[i])
+			.Add("median_ms", median * 1000.0)
+			.Add("min_ms", Minimum(*stageTimes[i]) * 1000.0)
+			.Add("per_instance_us", median * 1000000.0 / settings.instances);
+		output << line.Str() << "\n";
+	}
+	output.flush();
+
+	return EXIT_SUCCESS;
+}
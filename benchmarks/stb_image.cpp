@@ -0,0 +1,8 @@
+#include <benchmark.hpp>
+
+// Benchmark build of stb_image, decoded pixels are the largest allocations of an import so they go through the counters
+#define STBI_MALLOC(size) CountedMalloc(size)
+#define STBI_REALLOC(pointer, size) CountedRealloc(pointer, size)
+#define STBI_FREE(pointer) CountedFree(pointer)
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
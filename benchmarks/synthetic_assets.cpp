@@ -0,0 +1,153 @@
+#include <synthetic_assets.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+static unsigned int crc32(const unsigned char* data, size_t length, unsigned int crc) {
+	static unsigned int table[256];
+	static bool tableReady = false;
+	if (!tableReady) {
+		for (unsigned int i = 0; i < 256; i++) {
+			unsigned int value = i;
+			for (unsigned int j = 0; j < 8; j++)
+				value = value & 1 ? 0xedb88320 ^ (value >> 1) : value >> 1;
+			table[i] = value;
+		}
+		tableReady = true;
+	}
+
+	crc = ~crc;
+	for (size_t i = 0; i < length; i++)
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void appendUint32(std::vector<unsigned char>& out, unsigned int value) {
+	out.push_back((value >> 24) & 0xff);
+	out.push_back((value >> 16) & 0xff);
+	out.push_back((value >> 8) & 0xff);
+	out.push_back(value & 0xff);
+}
+
+static void writeChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data) {
+	std::vector<unsigned char> chunk;
+	appendUint32(chunk, (unsigned int)data.size());
+	chunk.insert(chunk.end(), type, type + 4);
+	chunk.insert(chunk.end(), data.begin(), data.end());
+	appendUint32(chunk, crc32(&chunk[4], chunk.size() - 4, 0));
+	file.write((const char*)chunk.data(), chunk.size());
+}
+
+// PNG with stored (uncompressed) deflate blocks, stb_image still runs its full inflate and unfilter path on it
+static void writePng(const std::string& path, unsigned int size, unsigned int components, unsigned int seed) {
+	std::vector<unsigned char> scanlines;
+	scanlines.reserve((size * components + 1) * size);
+	for (unsigned int y = 0; y < size; y++) {
+		scanlines.push_back(0);
+		for (unsigned int x = 0; x < size; x++) {
+			for (unsigned int c = 0; c < components; c++)
+				scanlines.push_back((unsigned char)((x ^ y) * (c + 1) + seed * 37));
+		}
+	}
+
+	std::vector<unsigned char> header;
+	appendUint32(header, size);
+	appendUint32(header, size);
+	header.push_back(8);
+	header.push_back(components == 1 ? 0 : 2);
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+
+	std::vector<unsigned char> zlib;
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+	for (size_t offset = 0; offset < scanlines.size(); offset += 65535) {
+		size_t length = std::min<size_t>(65535, scanlines.size() - offset);
+		zlib.push_back(offset + length == scanlines.size() ? 1 : 0);
+		zlib.push_back(length & 0xff);
+		zlib.push_back((length >> 8) & 0xff);
+		zlib.push_back(~length & 0xff);
+		zlib.push_back((~length >> 8) & 0xff);
+		zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + length);
+	}
+
+	unsigned int a = 1, b = 0;
+	for (size_t i = 0; i < scanlines.size(); i++) {
+		a = (a + scanlines[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	appendUint32(zlib, (b << 16) | a);
+
+	std::ofstream file(path, std::ios::binary);
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	file.write((const char*)signature, sizeof(signature));
+	writeChunk(file, "IHDR", header);
+	writeChunk(file, "IDAT", zlib);
+	writeChunk(file, "IEND", std::vector<unsigned char>());
+}
+
+unsigned int SyntheticGridSide(const SyntheticModelSettings& settings) {
+	return std::max(2u, (unsigned int)std::ceil(std::sqrt((double)settings.verticesPerMesh)));
+}
+
+std::string GenerateSyntheticModel(const std::string& directory, const SyntheticModelSettings& settings) {
+	std::filesystem::create_directories(directory);
+
+	unsigned int meshCount = std::max(1u, settings.meshCount);
+	unsigned int materialCount = (unsigned int)std::lround(meshCount * (1.0f - settings.sharingRatio));
+	materialCount = std::max(1u, std::min(meshCount, materialCount));
+
+	std::ofstream materials(directory + "/model.mtl");
+	for (unsigned int i = 0; i < materialCount; i++) {
+		std::string diffuse = "diffuse_" + std::to_string(i) + ".png";
+		std::string specular = "specular_" + std::to_string(i) + ".png";
+		writePng(directory + "/" + diffuse, settings.textureSize, 3, i);
+		writePng(directory + "/" + specular, settings.textureSize, 1, i);
+
+		materials << "newmtl material_" << i << "\n";
+		materials << "map_Kd " << diffuse << "\n";
+		materials << "map_Ks " << specular << "\n\n";
+	}
+
+	// each mesh is a square grid of vertices, laid out side by side so they don't overlap
+	unsigned int side = SyntheticGridSide(settings);
+	std::string path = directory + "/model.obj";
+	std::ofstream model(path);
+	model << "mtllib model.mtl\n";
+
+	unsigned int base = 1;
+	for (unsigned int i = 0; i < meshCount; i++) {
+		float offsetX = (i % 8) * 1.1f;
+		float offsetY = (i / 8) * 1.1f;
+
+		model << "o mesh_" << i << "\n";
+		model << "usemtl material_" << i % materialCount << "\n";
+		for (unsigned int y = 0; y < side; y++) {
+			for (unsigned int x = 0; x < side; x++) {
+				float u = (float)x / (side - 1);
+				float v = (float)y / (side - 1);
+				model << "v " << offsetX + u << " " << offsetY + v << " 0\n";
+				model << "vt " << u << " " << v << "\n";
+				model << "vn 0 0 1\n";
+			}
+		}
+
+		for (unsigned int y = 0; y + 1 < side; y++) {
+			for (unsigned int x = 0; x + 1 < side; x++) {
+				unsigned int a = base + y * side + x;
+				unsigned int b = a + 1;
+				unsigned int c = a + side;
+				unsigned int d = c + 1;
+				model << "f " << a << "/" << a << "/" << a << " " << b << "/" << b << "/" << b << " " << d << "/" << d << "/" << d << "\n";
+				model << "f " << a << "/" << a << "/" << a << " " << d << "/" << d << "/" << d << " " << c << "/" << c << "/" << c << "\n";
+			}
+		}
+		base += side * side;
+	}
+
+	return path;
+}
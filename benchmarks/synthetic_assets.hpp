@@ -0,0 +1,20 @@
+#ifndef OPENGL_RENDERER_SYNTHETIC_ASSETS_HPP
+#define OPENGL_RENDERER_SYNTHETIC_ASSETS_HPP
+
+#include <string>
+
+struct SyntheticModelSettings {
+	unsigned int verticesPerMesh = 10000;
+	unsigned int meshCount = 16;
+	unsigned int textureSize = 512;
+	// fraction of meshes that reuse another mesh's material instead of getting their own textures
+	float sharingRatio = 0.5f;
+};
+
+// Each mesh is a square grid, this is its side in vertices so the vertex count is rounded up to the next square
+unsigned int SyntheticGridSide(const SyntheticModelSettings& settings);
+
+// Writes an OBJ with its MTL and PNG textures into directory and returns the path of the OBJ
+std::string GenerateSyntheticModel(const std::string& directory, const SyntheticModelSettings& settings);
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef OPENGL_RENDERER_ANIMATION_HPP
+#define OPENGL_RENDERER_ANIMATION_HPP
+
+#include <glm/glm.hpp>
+
+#include <shader.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class Model;
+
+// Must match MAX_BONES and the BonePalette block binding used by skinned.vert
+const unsigned int MAX_BONES = 128;
+const unsigned int BONE_PALETTE_BINDING = 0;
+
+// Clips are resampled to this rate on import
+const float ANIMATION_SAMPLE_RATE = 30.0f;
+
+enum Pose_Component {
+	POSE_TX, POSE_TY, POSE_TZ,
+	POSE_RX, POSE_RY, POSE_RZ, POSE_RW,
+	POSE_SX, POSE_SY, POSE_SZ,
+	POSE_COMPONENTS
+};
+
+// Local joint transforms as structure of arrays, one array per component. The joint count is padded
+// to a multiple of 4 with identity joints so every array can be processed 4 joints at a time
+struct Pose {
+	unsigned int stride = 0;
+	std::vector<float> data;
+
+	// resizes to hold jointCount joints and resets them all to identity
+	void Resize(unsigned int jointCount);
+
+	float* Component(Pose_Component component) { return &data[component * stride]; }
+	const float* Component(Pose_Component component) const { return &data[component * stride]; }
+};
+
+struct Skeleton {
+	// joints are ordered so parents always come before their children
+	std::vector<std::string> jointNames;
+	std::vector<int> parents;
+	Pose bindPose;
+
+	// skinning bones, the bone IDs in VertexBoneData index these
+	std::vector<int> boneJoints;
+	std::vector<glm::mat4> boneOffsets;
+
+	glm::mat4 globalInverse = glm::mat4(1.0f);
+
+	std::unordered_map<std::string, int> jointIndices;
+
+	unsigned int GetJointCount() const { return (unsigned int)parents.size(); }
+	int FindJoint(const std::string& name) const;
+};
+
+// Every joint sampled at ANIMATION_SAMPLE_RATE, so sampling a clip is a lerp between two whole frames.
+// Each frame is laid out like Pose::data and rotations of consecutive frames share a hemisphere
+struct AnimationClip {
+	std::string name;
+	float duration = 0.0f;
+	unsigned int frameCount = 0;
+	unsigned int stride = 0;
+	std::vector<float> frames;
+};
+
+// samples the clip at time in seconds, wrapping around its duration
+void SampleClip(const AnimationClip& clip, float time, Pose& pose);
+// out = a * (1 - weight) + b * weight, out may alias a
+void BlendPoses(const Pose& a, const Pose& b, float weight, Pose& out);
+// writes one skinning matrix per bone, modelSpace is scratch space for the joint transforms
+void ComputeBonePalette(const Skeleton& skeleton, const Pose& pose, std::vector<glm::mat4>& modelSpace, glm::mat4* palette);
+
+struct AnimationInstance {
+	glm::mat4 transform = glm::mat4(1.0f);
+	int clip = 0;
+	float time = 0.0f;
+	// optional second clip blended on top, -1 disables blending
+	int blendClip = -1;
+	float blendTime = 0.0f;
+	float blendWeight = 0.0f;
+	float speed = 1.0f;
+};
+
+// Evaluates the poses of many instances of one skinned model across worker threads and uploads their bone palettes.
+// The workers live as long as the Animator and sleep between updates
+class Animator
+{
+public:
+	std::vector<AnimationInstance> instances;
+
+	Animator(const Skeleton& skeleton, const std::vector<AnimationClip>& clips, unsigned int threadCount = 0);
+	~Animator();
+
+	// advances every instance and evaluates its bone palette, CPU only
+	void Update(float deltaTime);
+	void Upload();
+	void Draw(Model& model, Shader& shader);
+
+	const glm::mat4* GetPalette(unsigned int instance) const { return palettes.data() + instance * skeleton.boneJoints.size(); }
+
+private:
+	struct Workspace {
+		Pose pose;
+		Pose blendPose;
+		std::vector<glm::mat4> modelSpace;
+	};
+
+	const Skeleton& skeleton;
+	const std::vector<AnimationClip>& clips;
+	std::vector<Workspace> workspaces;
+	std::vector<glm::mat4> palettes;
+	// palettes laid out at paletteStride for the uniform buffer
+	std::vector<unsigned char> staging;
+	unsigned int UBO = 0;
+	size_t paletteStride = 0;
+
+	// workers[i] evaluates with workspaces[i + 1], the calling thread uses workspaces[0]
+	std::vector<std::thread> workers;
+	std::mutex workMutex;
+	std::condition_variable workReady;
+	std::condition_variable workDone;
+	// bumped by every parallel Update, a worker runs once for each value it sees
+	unsigned int generation = 0;
+	unsigned int workersPending = 0;
+	unsigned int perWorker = 0;
+	bool stopping = false;
+
+	void evaluate(unsigned int first, unsigned int last, Workspace& workspace);
+	void workerLoop(unsigned int index);
+};
+
+#endif
@@ -13,11 +13,11 @@ struct FileSystem {
 		return NULL;
 	}
 
-	static const char* GetPath(const std::string& path) {
+	static std::string GetPath(const std::string& path) {
 		const char* root = GetRoot();
 		if(root)
-			return std::string(root + path).c_str();
-		return NULL;
+			return std::string(root) + path;
+		return path;
 	}
 };
 
@@ -3,6 +3,7 @@
 
 #include <glm/glm.hpp>
 
+#include <meshlet.hpp>
 #include <shader.hpp>
 
 #include <string>
@@ -14,6 +15,14 @@ struct Vertex {
 	glm::vec2 texCoords;
 };
 
+const unsigned int MAX_BONE_INFLUENCE = 4;
+
+// Skinning influences, kept in a second vertex buffer that only skinned meshes have
+struct VertexBoneData {
+	int boneIDs[MAX_BONE_INFLUENCE];
+	float weights[MAX_BONE_INFLUENCE];
+};
+
 struct Texture {
 	unsigned int ID;
 	std::string type;
@@ -25,12 +34,27 @@ public:
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
 	std::vector<Texture> textures;
+	std::vector<Meshlet> meshlets;
+	std::vector<VertexBoneData> boneData;
 
-	Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Texture>& texures);
+	Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Texture>& texures,
+		const std::vector<VertexBoneData>& boneData = std::vector<VertexBoneData>());
 	void Draw(Shader& shader);
+	// draws only the meshlets inside the frustum that face the camera, both given in model space
+	void Draw(Shader& shader, const Frustum& frustum, const glm::vec3& cameraPosition);
+	// creates the GL buffers and frees the CPU vertex, index and bone arrays, the constructor only does CPU work
+	// so meshes can be built off the GL thread
+	void Upload();
+	void Release();
+	// bytes held on the CPU and GPU together, each array is only counted where it currently lives
+	size_t GetByteSize() const;
 private:
-	unsigned int VAO, VBO, EBO;
-	void setupMesh();
+	unsigned int VAO = 0, VBO = 0, EBO = 0, boneVBO = 0;
+	unsigned int indexCount = 0;
+	size_t uploadedBytes = 0;
+	std::vector<int> drawCounts;
+	std::vector<const void*> drawOffsets;
+	void bindTextures(Shader& shader);
 
 };
 
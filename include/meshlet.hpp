@@ -0,0 +1,46 @@
+#ifndef OPENGL_RENDERER_MESHLET_HPP
+#define OPENGL_RENDERER_MESHLET_HPP
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+struct Vertex;
+
+// Meshlet limits, sized so a cluster fits the common mesh shader budget
+const unsigned int MESHLET_MAX_VERTICES = 64;
+const unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+// A contiguous range of a mesh's index buffer with bounds used for culling
+struct Meshlet {
+	unsigned int indexOffset;
+	unsigned int indexCount;
+	unsigned int vertexCount;
+
+	// bounding sphere in model space
+	glm::vec3 center;
+	float radius;
+
+	// normal cone, the cluster is backfacing when viewed from inside the cone behind it
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
+// Frustum planes in the form ax + by + cz + d, normals point inward
+struct Frustum {
+	glm::vec4 planes[6];
+};
+
+// Reorders indices so each meshlet is contiguous and returns the meshlets in index buffer order
+std::vector<Meshlet> BuildMeshlets(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+// Extracts the frustum planes from a (projection * view * model) matrix, giving planes in model space
+Frustum ExtractFrustum(const glm::mat4& matrix);
+
+bool IsMeshletVisible(const Meshlet& meshlet, const Frustum& frustum, const glm::vec3& cameraPosition);
+
+// Culls meshlets and merges the surviving adjacent ranges into glMultiDrawElements arguments
+void CullMeshlets(const std::vector<Meshlet>& meshlets, const Frustum& frustum, const glm::vec3& cameraPosition,
+	std::vector<int>& counts, std::vector<const void*>& offsets);
+
+#endif
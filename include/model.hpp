@@ -7,32 +7,101 @@
 
 #include <stb_image.h>
 
+#include <animation.hpp>
 #include <mesh.hpp>
 #include <shader.hpp>
 
+#include <memory>
 #include <string>
 #include <vector>
 
+// decoded image waiting for upload, decoding does not touch GL so it can run on any thread
+struct TextureImage {
+	int width = 0;
+	int height = 0;
+	int components = 0;
+	std::shared_ptr<unsigned char> pixels;
+};
+
+TextureImage LoadTextureImage(const char* path, const std::string& directory);
+unsigned int UploadTexture(const TextureImage& image);
 unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false);
 
+// Creates the GPU side of imported data, tools without a GL context can pass their own
+class Uploader
+{
+public:
+	virtual ~Uploader() {}
+	virtual unsigned int UploadTexture(const TextureImage& image) = 0;
+	virtual void UploadMesh(Mesh& mesh) = 0;
+};
+
+class GLUploader : public Uploader
+{
+public:
+	unsigned int UploadTexture(const TextureImage& image) override;
+	void UploadMesh(Mesh& mesh) override;
+};
+
+// Time spent in each import stage in seconds, with the amount of data they produced
+struct ImportStats {
+	double readFile = 0.0;
+	double processMesh = 0.0;
+	double buildMeshlets = 0.0;
+	double loadMaterialTextures = 0.0;
+	double textureDecode = 0.0;
+	double upload = 0.0;
+	unsigned int meshes = 0;
+	size_t vertices = 0;
+	size_t indices = 0;
+	size_t meshlets = 0;
+	unsigned int texturesDecoded = 0;
+	unsigned int texturesShared = 0;
+};
+
 class Model
 {
 public:
-	Model(const char* path) {
+	// pass upload = false to only import on the CPU, Upload() must then be called on the GL thread before drawing
+	Model(const std::string& path, bool upload = true) {
 		loadModel(path);
+		if (upload)
+			Upload();
 	}
 
+	void Upload();
+	void Upload(Uploader& uploader);
+	// frees the GL objects, decoded images and mesh geometry are dropped once uploaded so a released model can't be uploaded again
+	void Release();
+	bool IsUploaded() const { return uploaded; }
+	size_t GetByteSize() const;
+	const ImportStats& GetImportStats() const { return importStats; }
+	const Skeleton& GetSkeleton() const { return skeleton; }
+	const std::vector<AnimationClip>& GetAnimations() const { return animations; }
+
 	void Draw(Shader& shader);
+	// draws with per-meshlet frustum and backface culling
+	void Draw(Shader& shader, const glm::mat4& model, const glm::mat4& viewProjection, const glm::vec3& cameraPosition);
 
 private:
 	std::vector<Mesh> meshes;
 	std::vector<Texture> texturesLoaded;
+	std::vector<TextureImage> texturesPending;
 	std::string directory;
+	size_t textureBytes = 0;
+	bool uploaded = false;
+	bool released = false;
+	ImportStats importStats;
+	Skeleton skeleton;
+	std::vector<AnimationClip> animations;
 
 	void loadModel(std::string path);
 	void processNode(aiNode* node, const aiScene* scene);
 	Mesh processMesh(aiMesh* mesh, const aiScene* scene);
 	std::vector<Texture> loadMaterialTextures(aiMaterial* material, aiTextureType type, std::string typeName);
+	void loadSkeleton(const aiScene* scene);
+	void loadAnimation(const aiAnimation* animation);
+	int findOrAddBone(const aiBone* bone);
 };
 
 #endif
\ No newline at end of file
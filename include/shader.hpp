@@ -21,6 +21,7 @@ public:
 	void setMatrix4f(const char* uniformName, const glm::mat4& value);
 	void setVec3(const char* uniformName, const glm::vec3& value);
 	void setVec3(const char* uniformName, float x, float y, float z);
+	void setUniformBlock(const char* blockName, unsigned int binding);
 	void use();
 };
 
@@ -0,0 +1,101 @@
+#ifndef OPENGL_RENDERER_WORLD_HPP
+#define OPENGL_RENDERER_WORLD_HPP
+
+#include <glm/glm.hpp>
+
+#include <camera.hpp>
+#include <model.hpp>
+#include <shader.hpp>
+
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Streaming limits, distances are in world units measured to the chunk center
+struct StreamingSettings {
+	float loadDistance = 96.0f;
+	float unloadDistance = 128.0f;
+	// how far ahead of the camera's motion loads are requested, in seconds
+	float prefetchTime = 1.0f;
+	size_t memoryBudget = 512 * 1024 * 1024;
+	unsigned int maxConcurrentLoads = 2;
+	unsigned int maxUploadsPerFrame = 1;
+	float hitchThreshold = 1.0f / 30.0f;
+};
+
+struct StreamingStats {
+	size_t residentBytes = 0;
+	unsigned int residentChunks = 0;
+	unsigned int queueDepth = 0;
+	unsigned int loadsInFlight = 0;
+	unsigned int hitches = 0;
+	float lastUploadTime = 0.0f;
+	float worstFrameTime = 0.0f;
+};
+
+enum Chunk_State {
+	CHUNK_UNLOADED,
+	CHUNK_LOADING,
+	CHUNK_RESIDENT
+};
+
+// A cooked model tile covering one cell of the world grid, its vertices are already in world space
+struct WorldChunk {
+	glm::ivec3 coord;
+	std::string path;
+	Chunk_State state = CHUNK_UNLOADED;
+	float distance = 0.0f;
+	size_t bytes = 0;
+	// last frame the chunk was added to the nearby list
+	unsigned int visitedFrame = 0;
+	std::unique_ptr<Model> model;
+	std::future<std::unique_ptr<Model>> pending;
+};
+
+// Loads chunks of a world manifest around the camera on worker threads and evicts them when far away or over budget
+//
+// manifest format, chunk paths are relative to the manifest:
+//     chunk_size 64
+//     chunk 0 0 0 chunks/0_0_0.obj
+class WorldStreamer
+{
+public:
+	StreamingSettings settings;
+
+	WorldStreamer(const std::string& manifestPath, const StreamingSettings& settings = StreamingSettings());
+	~WorldStreamer();
+
+	// call once per frame on the GL thread, finished loads are uploaded here
+	void Update(const Camera& camera, float deltaTime);
+	void Draw(Shader& shader, const glm::mat4& viewProjection, const glm::vec3& cameraPosition);
+
+	const StreamingStats& GetStats() const { return stats; }
+
+private:
+	std::vector<WorldChunk> chunks;
+	// chunk index by packed grid cell, so a frame only looks at the cells around the camera
+	std::unordered_map<long long, unsigned int> cells;
+	// chunks in cells within streaming range of the camera or its predicted position, plus every loading or resident chunk
+	std::vector<WorldChunk*> nearby;
+	unsigned int frame = 0;
+	std::string directory;
+	float chunkSize = 64.0f;
+	glm::vec3 lastPosition;
+	glm::vec3 velocity = glm::vec3(0.0f);
+	bool firstUpdate = true;
+	StreamingStats stats;
+
+	void loadManifest(const std::string& path);
+	void gatherNearbyChunks(const glm::vec3& position, const glm::vec3& predicted);
+	void visitCells(const glm::vec3& position);
+	void visitChunk(WorldChunk& chunk);
+	void updatePriorities(const glm::vec3& position, const glm::vec3& predicted);
+	float uploadFinishedLoads();
+	void evictChunks();
+	void requestLoads();
+	void unloadChunk(WorldChunk& chunk);
+};
+
+#endif
@@ -0,0 +1,38 @@
+#version 330 core
+
+const int MAX_BONES = 128;
+const int MAX_BONE_INFLUENCE = 4;
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in ivec4 aBoneIDs;
+layout (location = 4) in vec4 aWeights;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+layout (std140) uniform BonePalette {
+	mat4 bones[MAX_BONES];
+};
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+	mat4 skin = mat4(0.0);
+	for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+		skin += bones[aBoneIDs[i]] * aWeights[i];
+
+	// vertices without influences stay in bind pose
+	if (aWeights[0] + aWeights[1] + aWeights[2] + aWeights[3] == 0.0)
+		skin = mat4(1.0);
+
+	FragPos = vec3(model * skin * vec4(aPos, 1.0));
+	Normal = mat3(model) * mat3(skin) * aNormal;
+	TexCoords = aTexCoords;
+
+	gl_Position = projection * view * vec4(FragPos, 1.0);
+}
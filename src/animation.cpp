@@ -0,0 +1,323 @@
+#include <animation.hpp>
+#include <model.hpp>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ANIMATION_SSE2
+#include <emmintrin.h>
+#endif
+
+// out[i] = a[i] + (b[i] - a[i]) * t, count is a multiple of 4
+static void lerpArrays(float* out, const float* a, const float* b, float t, unsigned int count) {
+#ifdef ANIMATION_SSE2
+	__m128 weight = _mm_set1_ps(t);
+	for (unsigned int i = 0; i < count; i += 4) {
+		__m128 va = _mm_loadu_ps(a + i);
+		__m128 vb = _mm_loadu_ps(b + i);
+		_mm_storeu_ps(out + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), weight)));
+	}
+#else
+	for (unsigned int i = 0; i < count; i++)
+		out[i] = a[i] + (b[i] - a[i]) * t;
+#endif
+}
+
+static void normalizeRotations(Pose& pose) {
+	float* x = pose.Component(POSE_RX);
+	float* y = pose.Component(POSE_RY);
+	float* z = pose.Component(POSE_RZ);
+	float* w = pose.Component(POSE_RW);
+
+#ifdef ANIMATION_SSE2
+	__m128 one = _mm_set1_ps(1.0f);
+	for (unsigned int i = 0; i < pose.stride; i += 4) {
+		__m128 vx = _mm_loadu_ps(x + i);
+		__m128 vy = _mm_loadu_ps(y + i);
+		__m128 vz = _mm_loadu_ps(z + i);
+		__m128 vw = _mm_loadu_ps(w + i);
+		__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_add_ps(_mm_mul_ps(vz, vz), _mm_mul_ps(vw, vw)));
+		__m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+		_mm_storeu_ps(x + i, _mm_mul_ps(vx, inverseLength));
+		_mm_storeu_ps(y + i, _mm_mul_ps(vy, inverseLength));
+		_mm_storeu_ps(z + i, _mm_mul_ps(vz, inverseLength));
+		_mm_storeu_ps(w + i, _mm_mul_ps(vw, inverseLength));
+	}
+#else
+	for (unsigned int i = 0; i < pose.stride; i++) {
+		float inverseLength = 1.0f / std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i] + w[i] * w[i]);
+		x[i] *= inverseLength;
+		y[i] *= inverseLength;
+		z[i] *= inverseLength;
+		w[i] *= inverseLength;
+	}
+#endif
+}
+
+void Pose::Resize(unsigned int jointCount) {
+	stride = (jointCount + 3) & ~3u;
+	data.assign(POSE_COMPONENTS * stride, 0.0f);
+	std::fill(data.begin() + POSE_RW * stride, data.begin() + (POSE_RW + 1) * stride, 1.0f);
+	std::fill(data.begin() + POSE_SX * stride, data.end(), 1.0f);
+}
+
+int Skeleton::FindJoint(const std::string& name) const {
+	std::unordered_map<std::string, int>::const_iterator joint = jointIndices.find(name);
+	if (joint == jointIndices.end())
+		return -1;
+	return joint->second;
+}
+
+void SampleClip(const AnimationClip& clip, float time, Pose& pose) {
+	unsigned int frameSize = POSE_COMPONENTS * clip.stride;
+	if (pose.stride != clip.stride)
+		pose.Resize(clip.stride);
+
+	float position = 0.0f;
+	if (clip.duration > 0.0f) {
+		time = std::fmod(time, clip.duration);
+		if (time < 0.0f)
+			time += clip.duration;
+		position = time * ANIMATION_SAMPLE_RATE;
+	}
+
+	unsigned int frame = std::min((unsigned int)position, clip.frameCount - 1);
+	unsigned int nextFrame = std::min(frame + 1, clip.frameCount - 1);
+	const float* a = &clip.frames[frame * frameSize];
+	const float* b = &clip.frames[nextFrame * frameSize];
+
+	// baked frames keep rotations in one hemisphere, so all components lerp together and rotations only need renormalizing
+	lerpArrays(pose.data.data(), a, b, position - frame, frameSize);
+	normalizeRotations(pose);
+}
+
+void BlendPoses(const Pose& a, const Pose& b, float weight, Pose& out) {
+	if (out.stride != a.stride)
+		out.Resize(a.stride);
+
+	unsigned int stride = a.stride;
+	lerpArrays(out.Component(POSE_TX), a.Component(POSE_TX), b.Component(POSE_TX), weight, 3 * stride);
+	lerpArrays(out.Component(POSE_SX), a.Component(POSE_SX), b.Component(POSE_SX), weight, 3 * stride);
+
+	// the poses come from different clips, flip b's rotation where it's in the opposite hemisphere to take the short path
+	const float* ax = a.Component(POSE_RX);
+	const float* ay = a.Component(POSE_RY);
+	const float* az = a.Component(POSE_RZ);
+	const float* aw = a.Component(POSE_RW);
+	const float* bx = b.Component(POSE_RX);
+	const float* by = b.Component(POSE_RY);
+	const float* bz = b.Component(POSE_RZ);
+	const float* bw = b.Component(POSE_RW);
+	float* ox = out.Component(POSE_RX);
+	float* oy = out.Component(POSE_RY);
+	float* oz = out.Component(POSE_RZ);
+	float* ow = out.Component(POSE_RW);
+
+#ifdef ANIMATION_SSE2
+	__m128 t = _mm_set1_ps(weight);
+	__m128 zero = _mm_setzero_ps();
+	__m128 signBit = _mm_set1_ps(-0.0f);
+	for (unsigned int i = 0; i < stride; i += 4) {
+		__m128 vax = _mm_loadu_ps(ax + i);
+		__m128 vay = _mm_loadu_ps(ay + i);
+		__m128 vaz = _mm_loadu_ps(az + i);
+		__m128 vaw = _mm_loadu_ps(aw + i);
+		__m128 vbx = _mm_loadu_ps(bx + i);
+		__m128 vby = _mm_loadu_ps(by + i);
+		__m128 vbz = _mm_loadu_ps(bz + i);
+		__m128 vbw = _mm_loadu_ps(bw + i);
+
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vax, vbx), _mm_mul_ps(vay, vby)), _mm_add_ps(_mm_mul_ps(vaz, vbz), _mm_mul_ps(vaw, vbw)));
+		__m128 flip = _mm_and_ps(_mm_cmplt_ps(dot, zero), signBit);
+		vbx = _mm_xor_ps(vbx, flip);
+		vby = _mm_xor_ps(vby, flip);
+		vbz = _mm_xor_ps(vbz, flip);
+		vbw = _mm_xor_ps(vbw, flip);
+
+		_mm_storeu_ps(ox + i, _mm_add_ps(vax, _mm_mul_ps(_mm_sub_ps(vbx, vax), t)));
+		_mm_storeu_ps(oy + i, _mm_add_ps(vay, _mm_mul_ps(_mm_sub_ps(vby, vay), t)));
+		_mm_storeu_ps(oz + i, _mm_add_ps(vaz, _mm_mul_ps(_mm_sub_ps(vbz, vaz), t)));
+		_mm_storeu_ps(ow + i, _mm_add_ps(vaw, _mm_mul_ps(_mm_sub_ps(vbw, vaw), t)));
+	}
+#else
+	for (unsigned int i = 0; i < stride; i++) {
+		float sign = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i] + aw[i] * bw[i] < 0.0f ? -1.0f : 1.0f;
+		ox[i] = ax[i] + (bx[i] * sign - ax[i]) * weight;
+		oy[i] = ay[i] + (by[i] * sign - ay[i]) * weight;
+		oz[i] = az[i] + (bz[i] * sign - az[i]) * weight;
+		ow[i] = aw[i] + (bw[i] * sign - aw[i]) * weight;
+	}
+#endif
+
+	normalizeRotations(out);
+}
+
+void ComputeBonePalette(const Skeleton& skeleton, const Pose& pose, std::vector<glm::mat4>& modelSpace, glm::mat4* palette) {
+	unsigned int jointCount = skeleton.GetJointCount();
+	modelSpace.resize(jointCount);
+
+	const float* tx = pose.Component(POSE_TX);
+	const float* ty = pose.Component(POSE_TY);
+	const float* tz = pose.Component(POSE_TZ);
+	const float* rx = pose.Component(POSE_RX);
+	const float* ry = pose.Component(POSE_RY);
+	const float* rz = pose.Component(POSE_RZ);
+	const float* rw = pose.Component(POSE_RW);
+	const float* sx = pose.Component(POSE_SX);
+	const float* sy = pose.Component(POSE_SY);
+	const float* sz = pose.Component(POSE_SZ);
+
+	for (unsigned int i = 0; i < jointCount; i++) {
+		glm::mat4 local = glm::mat4_cast(glm::quat(rw[i], rx[i], ry[i], rz[i]));
+		local[0] *= sx[i];
+		local[1] *= sy[i];
+		local[2] *= sz[i];
+		local[3] = glm::vec4(tx[i], ty[i], tz[i], 1.0f);
+
+		int parent = skeleton.parents[i];
+		modelSpace[i] = parent >= 0 ? modelSpace[parent] * local : local;
+	}
+
+	for (unsigned int i = 0; i < skeleton.boneJoints.size(); i++) {
+		palette[i] = skeleton.globalInverse * modelSpace[skeleton.boneJoints[i]] * skeleton.boneOffsets[i];
+	}
+}
+
+Animator::Animator(const Skeleton& skeleton, const std::vector<AnimationClip>& clips, unsigned int threadCount) : skeleton(skeleton), clips(clips) {
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	workspaces.resize(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++) {
+		workspaces[i].pose.Resize(skeleton.GetJointCount());
+		workspaces[i].blendPose.Resize(skeleton.GetJointCount());
+		workspaces[i].modelSpace.resize(skeleton.GetJointCount());
+	}
+
+	for (unsigned int i = 1; i < threadCount; i++) {
+		workers.push_back(std::thread(&Animator::workerLoop, this, i));
+	}
+}
+
+Animator::~Animator() {
+	{
+		std::lock_guard<std::mutex> lock(workMutex);
+		stopping = true;
+	}
+	workReady.notify_all();
+	for (unsigned int i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+
+	if (UBO)
+		glDeleteBuffers(1, &UBO);
+}
+
+void Animator::Update(float deltaTime) {
+	unsigned int boneCount = (unsigned int)skeleton.boneJoints.size();
+	unsigned int instanceCount = (unsigned int)instances.size();
+	palettes.resize(instances.size() * boneCount);
+
+	for (unsigned int i = 0; i < instanceCount; i++) {
+		instances[i].time += deltaTime * instances[i].speed;
+		instances[i].blendTime += deltaTime * instances[i].speed;
+	}
+
+	if (workers.empty() || instanceCount <= 1) {
+		evaluate(0, instanceCount, workspaces[0]);
+		return;
+	}
+
+	// instances are independent, split them into one contiguous range per thread and wake the workers
+	{
+		std::lock_guard<std::mutex> lock(workMutex);
+		perWorker = (instanceCount + (unsigned int)workspaces.size() - 1) / (unsigned int)workspaces.size();
+		workersPending = (unsigned int)workers.size();
+		generation++;
+	}
+	workReady.notify_all();
+
+	evaluate(0, std::min(perWorker, instanceCount), workspaces[0]);
+
+	std::unique_lock<std::mutex> lock(workMutex);
+	workDone.wait(lock, [this] { return workersPending == 0; });
+}
+
+void Animator::workerLoop(unsigned int index) {
+	unsigned int seen = 0;
+	while (true) {
+		unsigned int first, last;
+		{
+			std::unique_lock<std::mutex> lock(workMutex);
+			workReady.wait(lock, [this, seen] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+
+			seen = generation;
+			unsigned int instanceCount = (unsigned int)instances.size();
+			first = std::min(index * perWorker, instanceCount);
+			last = std::min(first + perWorker, instanceCount);
+		}
+
+		evaluate(first, last, workspaces[index]);
+
+		std::lock_guard<std::mutex> lock(workMutex);
+		if (--workersPending == 0)
+			workDone.notify_one();
+	}
+}
+
+void Animator::evaluate(unsigned int first, unsigned int last, Workspace& workspace) {
+	unsigned int boneCount = (unsigned int)skeleton.boneJoints.size();
+	for (unsigned int i = first; i < last; i++) {
+		const AnimationInstance& instance = instances[i];
+		glm::mat4* palette = palettes.data() + i * boneCount;
+
+		if (instance.clip < 0 || instance.clip >= (int)clips.size()) {
+			ComputeBonePalette(skeleton, skeleton.bindPose, workspace.modelSpace, palette);
+			continue;
+		}
+
+		SampleClip(clips[instance.clip], instance.time, workspace.pose);
+		if (instance.blendClip >= 0 && instance.blendClip < (int)clips.size() && instance.blendWeight > 0.0f) {
+			SampleClip(clips[instance.blendClip], instance.blendTime, workspace.blendPose);
+			BlendPoses(workspace.pose, workspace.blendPose, instance.blendWeight, workspace.pose);
+		}
+		ComputeBonePalette(skeleton, workspace.pose, workspace.modelSpace, palette);
+	}
+}
+
+void Animator::Upload() {
+	if (!UBO) {
+		glGenBuffers(1, &UBO);
+
+		// each instance binds a full BonePalette block, ranges must start on the driver's offset alignment
+		int alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		paletteStride = (MAX_BONES * sizeof(glm::mat4) + alignment - 1) / alignment * alignment;
+	}
+
+	// pack the palettes at their aligned offsets so the whole frame goes to the driver in one call
+	size_t boneCount = skeleton.boneJoints.size();
+	staging.resize(paletteStride * instances.size());
+	for (size_t i = 0; i < instances.size(); i++) {
+		std::memcpy(staging.data() + i * paletteStride, palettes.data() + i * boneCount, boneCount * sizeof(glm::mat4));
+	}
+
+	// glBufferData orphans last frame's storage so the driver doesn't wait on draws still reading it
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferData(GL_UNIFORM_BUFFER, staging.size(), staging.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void Animator::Draw(Model& model, Shader& shader) {
+	for (unsigned int i = 0; i < instances.size(); i++) {
+		glBindBufferRange(GL_UNIFORM_BUFFER, BONE_PALETTE_BINDING, UBO, i * paletteStride, MAX_BONES * sizeof(glm::mat4));
+		shader.setMatrix4f("model", instances[i].transform);
+		model.Draw(shader);
+	}
+}
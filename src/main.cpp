@@ -9,8 +9,10 @@
 #include <filesystem.hpp>
 #include <model.hpp>
 #include <shader.hpp>
+#include <world.hpp>
 
 #include <iostream>
+#include <memory>
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 void mouseCallback(GLFWwindow* window, double xPosIn, double yPosIn);
@@ -36,7 +38,7 @@ const float NEAR_DISTANCE = 0.1f;
 const float FAR_DISTANCE = 100.0f;
 Camera camera = Camera(glm::vec3(0.0f, 0.0f, 3.0f));
 
-int main() {
+int main(int argc, char** argv) {
 
 	// initialize GLFW, OpenGL, and GLAD
 	// ---------------------------------------------------------------------------------------------------
@@ -81,6 +83,11 @@ int main() {
 	// ---------------------------------------------------------------------------------------------------
 	Model backpack(FileSystem::GetPath("/models/backpack/backpack.obj"));
 
+	// a world is only streamed when its manifest is passed on the command line
+	std::unique_ptr<WorldStreamer> world;
+	if (argc > 1)
+		world = std::make_unique<WorldStreamer>(argv[1]);
+
 	// Render
 	// ---------------------------------------------------------------------------------------------------
 	while (!glfwWindowShouldClose(window)) {
@@ -92,6 +99,10 @@ int main() {
 		// Input
 		processInput(window);
 
+		// Stream world chunks around the camera
+		if (world)
+			world->Update(camera, deltaTime);
+
 		// Clear color and depth buffer
 		glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -109,13 +120,21 @@ int main() {
 		shader.setMatrix4f("model", model);
 
 		shader.setFloat("material.shininess", 32.0f);
-		backpack.Draw(shader);
+		backpack.Draw(shader, model, projection * view, camera.Position);
+
+		// world chunks are stored in world space
+		if (world) {
+			shader.setMatrix4f("model", glm::mat4(1.0f));
+			world->Draw(shader, projection * view, camera.Position);
+		}
 
 		// Swap buffers and poll input events
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 	}
-	
+
+	// resident chunks own GL objects, release them while the context still exists
+	world.reset();
 	glfwTerminate();
 	return EXIT_SUCCESS;
 }
@@ -1,14 +1,38 @@
 #include <mesh.hpp>
 
-Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Texture>& texures) {
+Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Texture>& texures,
+	const std::vector<VertexBoneData>& boneData) {
 	this->vertices = vertices;
 	this->indices = indices;
 	this->textures = texures;
-
-	setupMesh();
+	this->boneData = boneData;
+	this->meshlets = BuildMeshlets(this->vertices, this->indices);
+	this->indexCount = (unsigned int)this->indices.size();
 }
 
 void Mesh::Draw(Shader& shader) {
+	bindTextures(shader);
+
+	// draw mesh
+	glBindVertexArray(VAO);
+	glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+	glBindVertexArray(0);
+}
+
+void Mesh::Draw(Shader& shader, const Frustum& frustum, const glm::vec3& cameraPosition) {
+	CullMeshlets(meshlets, frustum, cameraPosition, drawCounts, drawOffsets);
+	if (drawCounts.empty())
+		return;
+
+	bindTextures(shader);
+
+	// draw the surviving meshlet ranges
+	glBindVertexArray(VAO);
+	glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(), (GLsizei)drawCounts.size());
+	glBindVertexArray(0);
+}
+
+void Mesh::bindTextures(Shader& shader) {
 	unsigned int diffuseNum = 1;
 	unsigned int specularNum = 1;
 
@@ -25,14 +49,9 @@ void Mesh::Draw(Shader& shader) {
 		glBindTexture(GL_TEXTURE_2D, textures[i].ID);
 	}
 	glActiveTexture(GL_TEXTURE0);
-
-	// draw mesh
-	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
 }
 
-void Mesh::setupMesh() {
+void Mesh::Upload() {
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
 	glGenBuffers(1, &EBO);
@@ -56,4 +75,38 @@ void Mesh::setupMesh() {
 	// vertex texture coordinate
 	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
 	glEnableVertexAttribArray(2);
+
+	if (!boneData.empty()) {
+		glGenBuffers(1, &boneVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, boneVBO);
+		glBufferData(GL_ARRAY_BUFFER, boneData.size() * sizeof(VertexBoneData), &boneData[0], GL_STATIC_DRAW);
+
+		// bone IDs
+		glVertexAttribIPointer(3, MAX_BONE_INFLUENCE, GL_INT, sizeof(VertexBoneData), (void*)0);
+		glEnableVertexAttribArray(3);
+
+		// bone weights
+		glVertexAttribPointer(4, MAX_BONE_INFLUENCE, GL_FLOAT, GL_FALSE, sizeof(VertexBoneData), (void*)offsetof(VertexBoneData, weights));
+		glEnableVertexAttribArray(4);
+	}
+
+	// the GL buffers hold the only copy from here on, meshlets stay on the CPU for culling
+	uploadedBytes = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int) + boneData.size() * sizeof(VertexBoneData);
+	std::vector<Vertex>().swap(vertices);
+	std::vector<unsigned int>().swap(indices);
+	std::vector<VertexBoneData>().swap(boneData);
+}
+
+void Mesh::Release() {
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	if (boneVBO)
+		glDeleteBuffers(1, &boneVBO);
+	VAO = VBO = EBO = boneVBO = 0;
+}
+
+size_t Mesh::GetByteSize() const {
+	size_t bytes = meshlets.size() * sizeof(Meshlet) + uploadedBytes;
+	return bytes + vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int) + boneData.size() * sizeof(VertexBoneData);
 }
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include <meshlet.hpp>
+#include <mesh.hpp>
+
+#include <cmath>
+#include <cstddef>
+
+static const unsigned int NO_MESHLET = 0xffffffff;
+
+static void computeMeshletBounds(Meshlet& meshlet, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) {
+	// bounding sphere around the center of the cluster's bounding box
+	glm::vec3 minimum = vertices[indices[meshlet.indexOffset]].position;
+	glm::vec3 maximum = minimum;
+	for (unsigned int i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i++) {
+		minimum = glm::min(minimum, vertices[indices[i]].position);
+		maximum = glm::max(maximum, vertices[indices[i]].position);
+	}
+
+	meshlet.center = (minimum + maximum) * 0.5f;
+	meshlet.radius = 0.0f;
+	for (unsigned int i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i++) {
+		meshlet.radius = std::fmax(meshlet.radius, glm::length(vertices[indices[i]].position - meshlet.center));
+	}
+
+	// normal cone from the triangle face normals, vertex normals are smoothed and would make the cone too narrow
+	std::vector<glm::vec3> normals;
+	normals.reserve(meshlet.indexCount / 3);
+	glm::vec3 axis = glm::vec3(0.0f);
+	for (unsigned int i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i += 3) {
+		glm::vec3 a = vertices[indices[i]].position;
+		glm::vec3 b = vertices[indices[i + 1]].position;
+		glm::vec3 c = vertices[indices[i + 2]].position;
+		glm::vec3 normal = glm::cross(b - a, c - a);
+		float area = glm::length(normal);
+		if (area <= 0.0f)
+			continue;
+
+		normal /= area;
+		normals.push_back(normal);
+		axis += normal;
+	}
+
+	// a cutoff of 1 disables cone culling for the cluster
+	meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = 1.0f;
+
+	float axisLength = glm::length(axis);
+	if (axisLength <= 0.0f)
+		return;
+	axis /= axisLength;
+
+	float minimumDot = 1.0f;
+	for (unsigned int i = 0; i < normals.size(); i++) {
+		minimumDot = std::fmin(minimumDot, glm::dot(normals[i], axis));
+	}
+
+	// cones wider than ~84 degrees from the axis reject too few views to be worth testing
+	if (minimumDot <= 0.1f)
+		return;
+
+	meshlet.coneAxis = axis;
+	meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+}
+
+std::vector<Meshlet> BuildMeshlets(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+	std::vector<Meshlet> meshlets;
+	unsigned int triangleCount = (unsigned int)(indices.size() / 3);
+	if (triangleCount == 0)
+		return meshlets;
+
+	// vertex to triangle adjacency so meshlets grow across shared edges instead of following file order
+	std::vector<unsigned int> adjacencyOffsets(vertices.size() + 1, 0);
+	for (unsigned int i = 0; i < triangleCount * 3; i++) {
+		adjacencyOffsets[indices[i] + 1]++;
+	}
+	for (unsigned int i = 0; i < vertices.size(); i++) {
+		adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+	}
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (unsigned int i = 0; i < triangleCount * 3; i++) {
+		adjacency[adjacencyFill[indices[i]]++] = i / 3;
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> vertexMeshlet(vertices.size(), NO_MESHLET);
+	std::vector<unsigned int> meshletVertices;
+	meshletVertices.reserve(MESHLET_MAX_VERTICES);
+
+	std::vector<unsigned int> reordered;
+	reordered.reserve(triangleCount * 3);
+
+	Meshlet meshlet = {};
+	unsigned int meshletIndex = 0;
+	unsigned int seedCursor = 0;
+
+	for (unsigned int emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+		// prefer the neighbouring triangle that adds the fewest new vertices to the current meshlet
+		unsigned int best = NO_MESHLET;
+		unsigned int bestNewVertices = 4;
+		for (unsigned int i = 0; i < meshletVertices.size() && bestNewVertices > 0; i++) {
+			unsigned int v = meshletVertices[i];
+			for (unsigned int j = adjacencyOffsets[v]; j < adjacencyOffsets[v + 1]; j++) {
+				unsigned int triangle = adjacency[j];
+				if (emitted[triangle])
+					continue;
+
+				unsigned int newVertices = 0;
+				for (unsigned int k = 0; k < 3; k++) {
+					if (vertexMeshlet[indices[triangle * 3 + k]] != meshletIndex)
+						newVertices++;
+				}
+				if (newVertices < bestNewVertices) {
+					best = triangle;
+					bestNewVertices = newVertices;
+				}
+			}
+		}
+
+		// no connected triangle left, continue with the next unused triangle in index order
+		if (best == NO_MESHLET) {
+			while (emitted[seedCursor])
+				seedCursor++;
+			best = seedCursor;
+			bestNewVertices = 3;
+		}
+
+		if (meshletVertices.size() + bestNewVertices > MESHLET_MAX_VERTICES || meshlet.indexCount / 3 + 1 > MESHLET_MAX_TRIANGLES) {
+			meshlets.push_back(meshlet);
+			meshletIndex++;
+			meshletVertices.clear();
+			meshlet = {};
+			meshlet.indexOffset = (unsigned int)reordered.size();
+		}
+
+		for (unsigned int k = 0; k < 3; k++) {
+			unsigned int v = indices[best * 3 + k];
+			if (vertexMeshlet[v] != meshletIndex) {
+				vertexMeshlet[v] = meshletIndex;
+				meshletVertices.push_back(v);
+			}
+			reordered.push_back(v);
+		}
+		meshlet.indexCount += 3;
+		meshlet.vertexCount = (unsigned int)meshletVertices.size();
+		emitted[best] = true;
+	}
+	meshlets.push_back(meshlet);
+
+	indices.swap(reordered);
+
+	for (unsigned int i = 0; i < meshlets.size(); i++) {
+		computeMeshletBounds(meshlets[i], vertices, indices);
+	}
+
+	return meshlets;
+}
+
+Frustum ExtractFrustum(const glm::mat4& matrix) {
+	glm::vec4 row0 = glm::vec4(matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]);
+	glm::vec4 row1 = glm::vec4(matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1]);
+	glm::vec4 row2 = glm::vec4(matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2]);
+	glm::vec4 row3 = glm::vec4(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+
+	Frustum frustum;
+	frustum.planes[0] = row3 + row0; // left
+	frustum.planes[1] = row3 - row0; // right
+	frustum.planes[2] = row3 + row1; // bottom
+	frustum.planes[3] = row3 - row1; // top
+	frustum.planes[4] = row3 + row2; // near
+	frustum.planes[5] = row3 - row2; // far
+
+	// normalize so plane distances are in model space units
+	for (unsigned int i = 0; i < 6; i++) {
+		frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+	}
+
+	return frustum;
+}
+
+bool IsMeshletVisible(const Meshlet& meshlet, const Frustum& frustum, const glm::vec3& cameraPosition) {
+	for (unsigned int i = 0; i < 6; i++) {
+		if (glm::dot(glm::vec3(frustum.planes[i]), meshlet.center) + frustum.planes[i].w < -meshlet.radius)
+			return false;
+	}
+
+	glm::vec3 toCenter = meshlet.center - cameraPosition;
+	if (glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius)
+		return false;
+
+	return true;
+}
+
+void CullMeshlets(const std::vector<Meshlet>& meshlets, const Frustum& frustum, const glm::vec3& cameraPosition,
+	std::vector<int>& counts, std::vector<const void*>& offsets) {
+	counts.clear();
+	offsets.clear();
+
+	unsigned int rangeEnd = NO_MESHLET;
+	for (unsigned int i = 0; i < meshlets.size(); i++) {
+		const Meshlet& meshlet = meshlets[i];
+		if (!IsMeshletVisible(meshlet, frustum, cameraPosition))
+			continue;
+
+		// meshlets are stored in index buffer order so neighbours that both survive share one draw
+		if (meshlet.indexOffset == rangeEnd) {
+			counts.back() += meshlet.indexCount;
+		}
+		else {
+			counts.push_back(meshlet.indexCount);
+			offsets.push_back((const void*)(meshlet.indexOffset * sizeof(unsigned int)));
+		}
+		rangeEnd = meshlet.indexOffset + meshlet.indexCount;
+	}
+}
@@ -1,43 +1,158 @@
 #include <model.hpp>
 
-unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma)
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static glm::mat4 toGlm(const aiMatrix4x4& m) {
+	// assimp matrices are row major
+	return glm::mat4(m.a1, m.b1, m.c1, m.d1, m.a2, m.b2, m.c2, m.d2, m.a3, m.b3, m.c3, m.d3, m.a4, m.b4, m.c4, m.d4);
+}
+
+// cursor remembers the last key used, so sampling frames in order stays linear in the key count
+static aiVector3D sampleVectorKeys(const aiVectorKey* keys, unsigned int count, double time, unsigned int& cursor) {
+	while (cursor + 1 < count && keys[cursor + 1].mTime <= time)
+		cursor++;
+	if (cursor + 1 >= count || time <= keys[cursor].mTime)
+		return keys[cursor].mValue;
+
+	float t = (float)((time - keys[cursor].mTime) / (keys[cursor + 1].mTime - keys[cursor].mTime));
+	return keys[cursor].mValue + (keys[cursor + 1].mValue - keys[cursor].mValue) * t;
+}
+
+static aiQuaternion sampleQuatKeys(const aiQuatKey* keys, unsigned int count, double time, unsigned int& cursor) {
+	while (cursor + 1 < count && keys[cursor + 1].mTime <= time)
+		cursor++;
+	if (cursor + 1 >= count || time <= keys[cursor].mTime)
+		return keys[cursor].mValue;
+
+	float t = (float)((time - keys[cursor].mTime) / (keys[cursor + 1].mTime - keys[cursor].mTime));
+	aiQuaternion result;
+	aiQuaternion::Interpolate(result, keys[cursor].mValue, keys[cursor + 1].mValue, t);
+	return result;
+}
+
+TextureImage LoadTextureImage(const char* path, const std::string& directory)
 {
 	std::string filename = std::string(path);
 	filename = directory + '/' + filename;
 
+	TextureImage image;
+	unsigned char* data = stbi_load(filename.c_str(), &image.width, &image.height, &image.components, 0);
+	if (data)
+		image.pixels = std::shared_ptr<unsigned char>(data, stbi_image_free);
+	else
+		std::cout << "Texture failed to load at path: " << path << std::endl;
+
+	return image;
+}
+
+unsigned int UploadTexture(const TextureImage& image)
+{
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
 
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-	if (data)
+	if (image.pixels)
 	{
 		GLenum format;
-		if (nrComponents == 1)
+		if (image.components == 1)
 			format = GL_RED;
-		else if (nrComponents == 3)
+		else if (image.components == 3)
 			format = GL_RGB;
-		else if (nrComponents == 4)
+		else if (image.components == 4)
 			format = GL_RGBA;
 
 		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels.get());
 		glGenerateMipmap(GL_TEXTURE_2D);
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	return textureID;
+}
+
+unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma)
+{
+	return UploadTexture(LoadTextureImage(path, directory));
+}
 
-		stbi_image_free(data);
+unsigned int GLUploader::UploadTexture(const TextureImage& image) {
+	return ::UploadTexture(image);
+}
+
+void GLUploader::UploadMesh(Mesh& mesh) {
+	mesh.Upload();
+}
+
+void Model::Upload() {
+	GLUploader uploader;
+	Upload(uploader);
+}
+
+void Model::Upload(Uploader& uploader) {
+	if (uploaded)
+		return;
+
+	// the pending images were freed by the first upload, reload the model instead
+	if (released || texturesPending.size() != texturesLoaded.size()) {
+		std::cout << "ERROR::MODEL::UPLOAD_AFTER_RELEASE::" << directory << std::endl;
+		return;
 	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < texturesLoaded.size(); i++) {
+		texturesLoaded[i].ID = uploader.UploadTexture(texturesPending[i]);
 	}
+	// the decoded pixels are only needed until they are on the GPU
+	texturesPending.clear();
 
-	return textureID;
+	for (unsigned int i = 0; i < meshes.size(); i++) {
+		std::vector<Texture>& textures = meshes[i].textures;
+		for (unsigned int j = 0; j < textures.size(); j++) {
+			for (unsigned int k = 0; k < texturesLoaded.size(); k++) {
+				if (textures[j].path == texturesLoaded[k].path) {
+					textures[j].ID = texturesLoaded[k].ID;
+					break;
+				}
+			}
+		}
+		uploader.UploadMesh(meshes[i]);
+	}
+
+	importStats.upload += secondsSince(start);
+	uploaded = true;
+}
+
+void Model::Release() {
+	if (!uploaded)
+		return;
+
+	for (unsigned int i = 0; i < meshes.size(); i++) {
+		meshes[i].Release();
+	}
+	for (unsigned int i = 0; i < texturesLoaded.size(); i++) {
+		glDeleteTextures(1, &texturesLoaded[i].ID);
+	}
+
+	uploaded = false;
+	released = true;
+}
+
+size_t Model::GetByteSize() const {
+	size_t bytes = textureBytes;
+	for (unsigned int i = 0; i < meshes.size(); i++) {
+		bytes += meshes[i].GetByteSize();
+	}
+	return bytes;
 }
 
 void Model::Draw(Shader& shader) {
@@ -46,9 +161,22 @@ void Model::Draw(Shader& shader) {
 	}
 }
 
+void Model::Draw(Shader& shader, const glm::mat4& model, const glm::mat4& viewProjection, const glm::vec3& cameraPosition) {
+	// cull in model space so meshlet bounds don't need to be transformed every frame
+	Frustum frustum = ExtractFrustum(viewProjection * model);
+	glm::vec3 localCameraPosition = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+
+	for (unsigned int i = 0; i < meshes.size(); i++) {
+		meshes[i].Draw(shader, frustum, localCameraPosition);
+	}
+}
+
 void Model::loadModel(std::string path) {
 	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	const aiScene* scene = importer.ReadFile(path,
+		aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_FlipUVs | aiProcess_LimitBoneWeights);
+	importStats.readFile += secondsSince(start);
 
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
 		std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
@@ -56,7 +184,14 @@ void Model::loadModel(std::string path) {
 	}
 	
 	directory = path.substr(0, path.find_last_of('/'));
+	loadSkeleton(scene);
 	processNode(scene->mRootNode, scene);
+
+	if (skeleton.GetJointCount() > 0) {
+		for (unsigned int i = 0; i < scene->mNumAnimations; i++) {
+			loadAnimation(scene->mAnimations[i]);
+		}
+	}
 }
 
 void Model::processNode(aiNode* node, const aiScene* scene) {
@@ -71,6 +206,7 @@ void Model::processNode(aiNode* node, const aiScene* scene) {
 }
 
 Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
 	std::vector<Texture> textures;
@@ -111,6 +247,47 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
 		}
 	}
 
+	// process bone weights, every mesh of a skinned model gets influences since the skinning shader draws them all.
+	// meshes without bones keep all zero weights, which the shader leaves in bind pose
+	std::vector<VertexBoneData> boneData;
+	if (skeleton.GetJointCount() > 0)
+		boneData.resize(mesh->mNumVertices, VertexBoneData());
+	if (mesh->HasBones()) {
+		for (unsigned int i = 0; i < mesh->mNumBones; i++) {
+			int bone = findOrAddBone(mesh->mBones[i]);
+			if (bone < 0)
+				continue;
+
+			for (unsigned int j = 0; j < mesh->mBones[i]->mNumWeights; j++) {
+				const aiVertexWeight& weight = mesh->mBones[i]->mWeights[j];
+				VertexBoneData& data = boneData[weight.mVertexId];
+
+				// replace the weakest influence, aiProcess_LimitBoneWeights already leaves at most four per vertex
+				unsigned int slot = 0;
+				for (unsigned int k = 1; k < MAX_BONE_INFLUENCE; k++) {
+					if (data.weights[k] < data.weights[slot])
+						slot = k;
+				}
+				if (weight.mWeight > data.weights[slot]) {
+					data.boneIDs[slot] = bone;
+					data.weights[slot] = weight.mWeight;
+				}
+			}
+		}
+
+		for (unsigned int i = 0; i < boneData.size(); i++) {
+			float total = 0.0f;
+			for (unsigned int j = 0; j < MAX_BONE_INFLUENCE; j++)
+				total += boneData[i].weights[j];
+			if (total > 0.0f) {
+				for (unsigned int j = 0; j < MAX_BONE_INFLUENCE; j++)
+					boneData[i].weights[j] /= total;
+			}
+		}
+	}
+
+	importStats.processMesh += secondsSince(start);
+
 	// process material
 	if (mesh->mMaterialIndex >= 0) {
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
@@ -122,10 +299,19 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
 		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
 	}
 
-	return Mesh(vertices, indices, textures);
+	start = std::chrono::steady_clock::now();
+	Mesh result(vertices, indices, textures, boneData);
+	importStats.buildMeshlets += secondsSince(start);
+
+	importStats.meshes++;
+	importStats.vertices += vertices.size();
+	importStats.indices += indices.size();
+	importStats.meshlets += result.meshlets.size();
+	return result;
 }
 
 std::vector<Texture> Model::loadMaterialTextures(aiMaterial* material, aiTextureType type, std::string typeName) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 	std::vector<Texture> textures;
 	for (unsigned int i = 0; i < material->GetTextureCount(type); i++) {
 		aiString str;
@@ -133,20 +319,162 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* material, aiTexture
 		bool skip = false;
 
 		for (unsigned int j = 0; j < texturesLoaded.size(); j++) {
-			if (std::strcmp(texturesLoaded[j].path.data(), str.C_Str())) {
-				textures.push_back(texturesLoaded[j]);
+			if (std::strcmp(texturesLoaded[j].path.data(), str.C_Str()) == 0) {
+				Texture texture = texturesLoaded[j];
+				texture.type = typeName;
+				textures.push_back(texture);
+				importStats.texturesShared++;
 				skip = true;
 				break;
 			}
 		}
 
+		// textures are decoded here and uploaded in Upload()
 		if (!skip) {
+			std::chrono::steady_clock::time_point decodeStart = std::chrono::steady_clock::now();
+			TextureImage image = LoadTextureImage(str.C_Str(), directory);
+			importStats.textureDecode += secondsSince(decodeStart);
+			importStats.texturesDecoded++;
+			textureBytes += (size_t)image.width * image.height * image.components;
+
 			Texture texture;
-			texture.ID = TextureFromFile(str.C_Str(), directory);
+			texture.ID = 0;
 			texture.type = typeName;
 			texture.path = str.C_Str();
 			textures.push_back(texture);
+			texturesLoaded.push_back(texture);
+			texturesPending.push_back(image);
 		}
 	}
+	importStats.loadMaterialTextures += secondsSince(start);
 	return textures;
 }
+
+void Model::loadSkeleton(const aiScene* scene) {
+	// only skinned or animated scenes need a skeleton
+	bool skinned = scene->mNumAnimations > 0;
+	for (unsigned int i = 0; i < scene->mNumMeshes && !skinned; i++) {
+		skinned = scene->mMeshes[i]->HasBones();
+	}
+	if (!skinned)
+		return;
+
+	// flatten the node hierarchy breadth first, which puts every parent before its children
+	std::vector<const aiNode*> nodes;
+	nodes.push_back(scene->mRootNode);
+	skeleton.parents.push_back(-1);
+	for (unsigned int i = 0; i < nodes.size(); i++) {
+		for (unsigned int j = 0; j < nodes[i]->mNumChildren; j++) {
+			nodes.push_back(nodes[i]->mChildren[j]);
+			skeleton.parents.push_back(i);
+		}
+	}
+
+	skeleton.bindPose.Resize((unsigned int)nodes.size());
+	Pose& pose = skeleton.bindPose;
+	for (unsigned int i = 0; i < nodes.size(); i++) {
+		skeleton.jointNames.push_back(nodes[i]->mName.C_Str());
+		skeleton.jointIndices[skeleton.jointNames.back()] = i;
+
+		aiVector3D scaling, position;
+		aiQuaternion rotation;
+		nodes[i]->mTransformation.Decompose(scaling, rotation, position);
+		pose.Component(POSE_TX)[i] = position.x;
+		pose.Component(POSE_TY)[i] = position.y;
+		pose.Component(POSE_TZ)[i] = position.z;
+		pose.Component(POSE_RX)[i] = rotation.x;
+		pose.Component(POSE_RY)[i] = rotation.y;
+		pose.Component(POSE_RZ)[i] = rotation.z;
+		pose.Component(POSE_RW)[i] = rotation.w;
+		pose.Component(POSE_SX)[i] = scaling.x;
+		pose.Component(POSE_SY)[i] = scaling.y;
+		pose.Component(POSE_SZ)[i] = scaling.z;
+	}
+
+	skeleton.globalInverse = glm::inverse(toGlm(scene->mRootNode->mTransformation));
+}
+
+void Model::loadAnimation(const aiAnimation* animation) {
+	double ticksPerSecond = animation->mTicksPerSecond != 0.0 ? animation->mTicksPerSecond : 25.0;
+
+	AnimationClip clip;
+	clip.name = animation->mName.C_Str();
+	clip.duration = (float)(animation->mDuration / ticksPerSecond);
+	clip.frameCount = (unsigned int)std::ceil(clip.duration * ANIMATION_SAMPLE_RATE) + 1;
+	clip.stride = skeleton.bindPose.stride;
+
+	// every frame starts as the bind pose so joints without a channel keep their rest transform
+	unsigned int stride = clip.stride;
+	unsigned int frameSize = POSE_COMPONENTS * stride;
+	clip.frames.resize(clip.frameCount * frameSize);
+	for (unsigned int i = 0; i < clip.frameCount; i++) {
+		std::copy(skeleton.bindPose.data.begin(), skeleton.bindPose.data.end(), clip.frames.begin() + i * frameSize);
+	}
+
+	for (unsigned int i = 0; i < animation->mNumChannels; i++) {
+		const aiNodeAnim* channel = animation->mChannels[i];
+		int joint = skeleton.FindJoint(channel->mNodeName.C_Str());
+		if (joint < 0)
+			continue;
+
+		unsigned int positionKey = 0, rotationKey = 0, scalingKey = 0;
+		for (unsigned int j = 0; j < clip.frameCount; j++) {
+			double time = std::min(j / ANIMATION_SAMPLE_RATE * ticksPerSecond, animation->mDuration);
+			float* frame = &clip.frames[j * frameSize];
+
+			if (channel->mNumPositionKeys > 0) {
+				aiVector3D position = sampleVectorKeys(channel->mPositionKeys, channel->mNumPositionKeys, time, positionKey);
+				frame[POSE_TX * stride + joint] = position.x;
+				frame[POSE_TY * stride + joint] = position.y;
+				frame[POSE_TZ * stride + joint] = position.z;
+			}
+
+			if (channel->mNumRotationKeys > 0) {
+				aiQuaternion rotation = sampleQuatKeys(channel->mRotationKeys, channel->mNumRotationKeys, time, rotationKey);
+
+				// keep consecutive frames in one hemisphere so SampleClip can lerp them without checking
+				if (j > 0) {
+					const float* previous = frame - frameSize;
+					float dot = previous[POSE_RX * stride + joint] * rotation.x + previous[POSE_RY * stride + joint] * rotation.y
+						+ previous[POSE_RZ * stride + joint] * rotation.z + previous[POSE_RW * stride + joint] * rotation.w;
+					if (dot < 0.0f)
+						rotation = aiQuaternion(-rotation.w, -rotation.x, -rotation.y, -rotation.z);
+				}
+
+				frame[POSE_RX * stride + joint] = rotation.x;
+				frame[POSE_RY * stride + joint] = rotation.y;
+				frame[POSE_RZ * stride + joint] = rotation.z;
+				frame[POSE_RW * stride + joint] = rotation.w;
+			}
+
+			if (channel->mNumScalingKeys > 0) {
+				aiVector3D scaling = sampleVectorKeys(channel->mScalingKeys, channel->mNumScalingKeys, time, scalingKey);
+				frame[POSE_SX * stride + joint] = scaling.x;
+				frame[POSE_SY * stride + joint] = scaling.y;
+				frame[POSE_SZ * stride + joint] = scaling.z;
+			}
+		}
+	}
+
+	animations.push_back(clip);
+}
+
+int Model::findOrAddBone(const aiBone* bone) {
+	int joint = skeleton.FindJoint(bone->mName.C_Str());
+	if (joint < 0)
+		return -1;
+
+	for (unsigned int i = 0; i < skeleton.boneJoints.size(); i++) {
+		if (skeleton.boneJoints[i] == joint)
+			return i;
+	}
+
+	if (skeleton.boneJoints.size() == MAX_BONES) {
+		std::cout << "ERROR::MODEL::TOO_MANY_BONES::" << bone->mName.C_Str() << std::endl;
+		return -1;
+	}
+
+	skeleton.boneJoints.push_back(joint);
+	skeleton.boneOffsets.push_back(toGlm(bone->mOffsetMatrix));
+	return (int)skeleton.boneJoints.size() - 1;
+}
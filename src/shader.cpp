@@ -101,6 +101,12 @@ void Shader::setVec3(const char* uniformName, float x, float y, float z) {
 	glUniform3f(glGetUniformLocation(ID, uniformName), x, y, z);
 }
 
+void Shader::setUniformBlock(const char* blockName, unsigned int binding) {
+	unsigned int index = glGetUniformBlockIndex(ID, blockName);
+	if (index != GL_INVALID_INDEX)
+		glUniformBlockBinding(ID, index, binding);
+}
+
 void Shader::use() {
 	glUseProgram(ID);
 }
\ No newline at end of file
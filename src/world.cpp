@@ -0,0 +1,254 @@
+#include <world.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static long long cellKey(const glm::ivec3& cell) {
+	// 21 bits per axis, a million cells either side of the origin
+	return ((long long)(cell.x & 0x1fffff) << 42) | ((long long)(cell.y & 0x1fffff) << 21) | (long long)(cell.z & 0x1fffff);
+}
+
+static bool compareDistance(const WorldChunk* a, const WorldChunk* b) {
+	return a->distance < b->distance;
+}
+
+WorldStreamer::WorldStreamer(const std::string& manifestPath, const StreamingSettings& settings) : settings(settings) {
+	loadManifest(manifestPath);
+}
+
+WorldStreamer::~WorldStreamer() {
+	for (unsigned int i = 0; i < chunks.size(); i++) {
+		// imports that haven't been uploaded own no GL objects, waiting for them is enough
+		if (chunks[i].state == CHUNK_LOADING)
+			chunks[i].pending.wait();
+		else if (chunks[i].state == CHUNK_RESIDENT)
+			unloadChunk(chunks[i]);
+	}
+}
+
+void WorldStreamer::Update(const Camera& camera, float deltaTime) {
+	if (firstUpdate) {
+		lastPosition = camera.Position;
+		firstUpdate = false;
+	}
+	else {
+		if (deltaTime > settings.hitchThreshold)
+			stats.hitches++;
+		stats.worstFrameTime = std::max(stats.worstFrameTime, deltaTime);
+	}
+
+	// smooth the velocity so a single long frame doesn't redirect prefetching
+	if (deltaTime > 0.0f)
+		velocity = glm::mix(velocity, (camera.Position - lastPosition) / deltaTime, 0.25f);
+	lastPosition = camera.Position;
+
+	glm::vec3 predicted = camera.Position + velocity * settings.prefetchTime;
+	gatherNearbyChunks(camera.Position, predicted);
+	updatePriorities(camera.Position, predicted);
+
+	stats.lastUploadTime = uploadFinishedLoads();
+	evictChunks();
+	requestLoads();
+}
+
+void WorldStreamer::Draw(Shader& shader, const glm::mat4& viewProjection, const glm::vec3& cameraPosition) {
+	for (unsigned int i = 0; i < chunks.size(); i++) {
+		if (chunks[i].state == CHUNK_RESIDENT)
+			chunks[i].model->Draw(shader, glm::mat4(1.0f), viewProjection, cameraPosition);
+	}
+}
+
+void WorldStreamer::loadManifest(const std::string& path) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		std::cout << "ERROR::WORLD::MANIFEST_NOT_FOUND::" << path << std::endl;
+		return;
+	}
+
+	directory = path.substr(0, path.find_last_of('/'));
+
+	std::string line;
+	while (std::getline(file, line)) {
+		std::istringstream stream(line);
+		std::string keyword;
+		if (!(stream >> keyword) || keyword[0] == '#')
+			continue;
+
+		if (keyword == "chunk_size") {
+			stream >> chunkSize;
+		}
+		else if (keyword == "chunk") {
+			WorldChunk chunk;
+			std::string chunkPath;
+			if (stream >> chunk.coord.x >> chunk.coord.y >> chunk.coord.z >> chunkPath) {
+				chunk.path = directory + '/' + chunkPath;
+				if (cells.count(cellKey(chunk.coord))) {
+					std::cout << "ERROR::WORLD::DUPLICATE_CHUNK::" << line << std::endl;
+					continue;
+				}
+				cells[cellKey(chunk.coord)] = (unsigned int)chunks.size();
+				chunks.push_back(std::move(chunk));
+			}
+			else {
+				std::cout << "ERROR::WORLD::INVALID_CHUNK::" << line << std::endl;
+			}
+		}
+	}
+}
+
+void WorldStreamer::gatherNearbyChunks(const glm::vec3& position, const glm::vec3& predicted) {
+	frame++;
+
+	// loading and resident chunks stay tracked wherever they are until they are unloaded
+	std::vector<WorldChunk*> previous;
+	previous.swap(nearby);
+	for (unsigned int i = 0; i < previous.size(); i++) {
+		if (previous[i]->state != CHUNK_UNLOADED)
+			visitChunk(*previous[i]);
+	}
+
+	visitCells(position);
+	visitCells(predicted);
+}
+
+void WorldStreamer::visitCells(const glm::vec3& position) {
+	// every cell whose center can be within streaming range, farther chunks are never looked at
+	float range = std::max(settings.loadDistance, settings.unloadDistance);
+	glm::ivec3 first = glm::ivec3(glm::floor((position - glm::vec3(range)) / chunkSize));
+	glm::ivec3 last = glm::ivec3(glm::floor((position + glm::vec3(range)) / chunkSize));
+	for (int x = first.x; x <= last.x; x++) {
+		for (int y = first.y; y <= last.y; y++) {
+			for (int z = first.z; z <= last.z; z++) {
+				std::unordered_map<long long, unsigned int>::const_iterator cell = cells.find(cellKey(glm::ivec3(x, y, z)));
+				if (cell != cells.end())
+					visitChunk(chunks[cell->second]);
+			}
+		}
+	}
+}
+
+void WorldStreamer::visitChunk(WorldChunk& chunk) {
+	if (chunk.visitedFrame == frame)
+		return;
+	chunk.visitedFrame = frame;
+	nearby.push_back(&chunk);
+}
+
+void WorldStreamer::updatePriorities(const glm::vec3& position, const glm::vec3& predicted) {
+	// a chunk is as urgent as the nearer of where the camera is and where it is heading
+	for (unsigned int i = 0; i < nearby.size(); i++) {
+		glm::vec3 center = (glm::vec3(nearby[i]->coord) + 0.5f) * chunkSize;
+		nearby[i]->distance = std::min(glm::distance(center, position), glm::distance(center, predicted));
+	}
+}
+
+float WorldStreamer::uploadFinishedLoads() {
+	std::vector<WorldChunk*> finished;
+	for (unsigned int i = 0; i < nearby.size(); i++) {
+		if (nearby[i]->state == CHUNK_LOADING && nearby[i]->pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			finished.push_back(nearby[i]);
+	}
+	std::sort(finished.begin(), finished.end(), compareDistance);
+
+	// uploads are capped per frame so a burst of finished loads doesn't stall a single frame
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	unsigned int uploads = 0;
+	for (unsigned int i = 0; i < finished.size(); i++) {
+		WorldChunk& chunk = *finished[i];
+		if (chunk.distance > settings.unloadDistance) {
+			chunk.pending.get();
+			chunk.state = CHUNK_UNLOADED;
+			continue;
+		}
+		if (uploads == settings.maxUploadsPerFrame)
+			continue;
+
+		chunk.model = chunk.pending.get();
+		chunk.model->Upload();
+		chunk.bytes = chunk.model->GetByteSize();
+		chunk.state = CHUNK_RESIDENT;
+		uploads++;
+	}
+
+	return std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+}
+
+void WorldStreamer::evictChunks() {
+	size_t residentBytes = 0;
+	unsigned int residentChunks = 0;
+	for (unsigned int i = 0; i < nearby.size(); i++) {
+		if (nearby[i]->state != CHUNK_RESIDENT)
+			continue;
+
+		if (nearby[i]->distance > settings.unloadDistance) {
+			unloadChunk(*nearby[i]);
+		}
+		else {
+			residentBytes += nearby[i]->bytes;
+			residentChunks++;
+		}
+	}
+
+	// over budget, drop the farthest chunks first
+	while (residentBytes > settings.memoryBudget) {
+		WorldChunk* farthest = NULL;
+		for (unsigned int i = 0; i < nearby.size(); i++) {
+			if (nearby[i]->state == CHUNK_RESIDENT && (!farthest || nearby[i]->distance > farthest->distance))
+				farthest = nearby[i];
+		}
+
+		residentBytes -= farthest->bytes;
+		residentChunks--;
+		unloadChunk(*farthest);
+	}
+
+	stats.residentBytes = residentBytes;
+	stats.residentChunks = residentChunks;
+}
+
+void WorldStreamer::requestLoads() {
+	std::vector<WorldChunk*> queue;
+	unsigned int loadsInFlight = 0;
+	size_t projectedBytes = stats.residentBytes;
+	for (unsigned int i = 0; i < nearby.size(); i++) {
+		if (nearby[i]->state == CHUNK_LOADING) {
+			loadsInFlight++;
+			projectedBytes += nearby[i]->bytes;
+		}
+		else if (nearby[i]->state == CHUNK_UNLOADED && nearby[i]->distance <= settings.loadDistance) {
+			queue.push_back(nearby[i]);
+		}
+	}
+	std::sort(queue.begin(), queue.end(), compareDistance);
+
+	unsigned int started = 0;
+	for (unsigned int i = 0; i < queue.size() && loadsInFlight < settings.maxConcurrentLoads; i++) {
+		WorldChunk& chunk = *queue[i];
+
+		// sizes are only known once a chunk has been loaded, this keeps evicted chunks from being reloaded straight away
+		if (projectedBytes + chunk.bytes > settings.memoryBudget)
+			continue;
+
+		std::string path = chunk.path;
+		chunk.pending = std::async(std::launch::async, [path]() {
+			return std::make_unique<Model>(path, false);
+		});
+		chunk.state = CHUNK_LOADING;
+		projectedBytes += chunk.bytes;
+		loadsInFlight++;
+		started++;
+	}
+
+	stats.queueDepth = (unsigned int)queue.size() - started;
+	stats.loadsInFlight = loadsInFlight;
+}
+
+void WorldStreamer::unloadChunk(WorldChunk& chunk) {
+	// bytes is kept so the budget check in requestLoads knows the chunk's size next time
+	chunk.model->Release();
+	chunk.model.reset();
+	chunk.state = CHUNK_UNLOADED;
+}